@@ -0,0 +1,182 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "backbone.h"
+#include "search.h"
+
+using namespace std;
+
+/* INTERNAL HELPERS */
+
+/**
+ * Marks every digit of a solution as possible in its cell.
+ *
+ * @param solution - a solved board.
+ * @param possible - the possible digits of each cell (bit d - 1 for digit d).
+ */
+static void mark_solution(const char solution[9][9], atomic<unsigned short> possible[81])
+{
+  for (int cell = 0; cell < 81; cell++)
+  {
+    possible[cell].fetch_or(1 << (solution[cell / 9][cell % 9] - '1'), memory_order_relaxed);
+  }
+}
+
+/* BACKBONE ANALYSIS */
+
+/**
+ * Finds, for every empty cell, which digits are forced, possible or impossible.
+ *
+ * @param board - a 9x9 character array representing the sudoku board.
+ * @param threads - the number of threads to run the probes on (at least 1).
+ * @param backbone - filled in with the candidate map and the counters.
+ *
+ * @return true - if the board has a solution, otherwise false.
+ */
+bool analyse_backbone(const char board[9][9], int threads, Backbone& backbone)
+{
+  return analyse_backbone(board, classic_topology(), threads, backbone);
+}
+
+/**
+ * Finds the forced, possible and impossible digits of every cell of a sudoku variant.
+ *
+ * @param board - a 9x9 character array representing the sudoku board.
+ * @param topology - the units of the variant.
+ * @param threads - the number of threads to run the probes on (at least 1).
+ * @param backbone - filled in with the candidate map and the counters.
+ *
+ * @return true - if the board has a solution, otherwise false.
+ */
+bool analyse_backbone(const char board[9][9], const Topology& topology, int threads,
+                      Backbone& backbone)
+{
+  if (threads < 1)
+  {
+    threads = 1;
+  }
+  for (int cell = 0; cell < 81; cell++)
+  {
+    for (int d = 0; d < 9; d++)
+    {
+      backbone.candidates[cell][d] = CANDIDATE_IMPOSSIBLE;
+    }
+  }
+  backbone.forced_cells = 0;
+  backbone.solutions = 0;
+  backbone.probes = 0;
+  backbone.refuted = 0;
+
+  // Without a first solution there is nothing to mark: every candidate is impossible
+  SearchState first;
+  search_init(first, board, topology);
+  const bool solvable = search_next(first);
+  backbone.nodes = first.nodes;
+  if (!solvable)
+  {
+    return false;
+  }
+
+  atomic<unsigned short> possible[81];
+  for (int cell = 0; cell < 81; cell++)
+  {
+    possible[cell] = 0;
+  }
+  mark_solution(first.board, possible);
+
+  // Only digits the givens allow need a probe; the rest cannot be in any solution
+  vector<unsigned char> probe_cells, probe_digits;
+  for (int cell = 0; cell < 81; cell++)
+  {
+    const int row = cell / 9, column = cell % 9;
+    if (board[row][column] != '.')
+    {
+      continue;
+    }
+    for (int d = 0; d < 9; d++)
+    {
+      if (!((possible[cell] >> d) & 1) && is_move_valid(row, column, '1' + d, board, topology))
+      {
+        probe_cells.push_back(cell);
+        probe_digits.push_back(d);
+      }
+    }
+  }
+
+  atomic<size_t> next_probe(0);
+  atomic<int> solutions(1), probes(0), refuted(0);
+  atomic<long long> nodes(0);
+
+  auto worker = [&]()
+  {
+    size_t index;
+    while ((index = next_probe.fetch_add(1)) < probe_cells.size())
+    {
+      // A solution found since the list was made may already have covered this candidate
+      const int cell = probe_cells[index], d = probe_digits[index];
+      if ((possible[cell].load(memory_order_relaxed) >> d) & 1)
+      {
+        continue;
+      }
+
+      char probe[9][9];
+      for (int row = 0; row < 9; row++)
+      {
+        for (int column = 0; column < 9; column++)
+        {
+          probe[row][column] = board[row][column];
+        }
+      }
+      probe[cell / 9][cell % 9] = '1' + d;
+
+      SearchState state;
+      search_init(state, probe, topology);
+      const bool found = search_next(state);
+      probes++;
+      nodes += state.nodes;
+      if (found)
+      {
+        solutions++;
+        mark_solution(state.board, possible);
+      }
+      else
+      {
+        refuted++;
+      }
+    }
+  };
+
+  vector<thread> pool;
+  for (int t = 1; t < threads; t++)
+  {
+    pool.push_back(thread(worker));
+  }
+  worker();
+  for (size_t t = 0; t < pool.size(); t++)
+  {
+    pool[t].join();
+  }
+
+  // A digit is forced when no solution puts any other digit in its cell
+  for (int cell = 0; cell < 81; cell++)
+  {
+    const unsigned short digits = possible[cell];
+    const bool forced = __builtin_popcount(digits) == 1;
+    for (int d = 0; d < 9; d++)
+    {
+      if ((digits >> d) & 1)
+      {
+        backbone.candidates[cell][d] = forced ? CANDIDATE_FORCED : CANDIDATE_POSSIBLE;
+      }
+    }
+    if (forced && board[cell / 9][cell % 9] == '.')
+    {
+      backbone.forced_cells++;
+    }
+  }
+  backbone.solutions = solutions;
+  backbone.probes = probes;
+  backbone.refuted = refuted;
+  backbone.nodes += nodes;
+  return true;
+}
@@ -0,0 +1,85 @@
+#ifndef BACKBONE_H
+#define BACKBONE_H
+
+#include "topology.h"
+
+/* BACKBONE ANALYSIS */
+
+/**
+ * What the solutions of a board say about one candidate digit of a cell.
+ */
+enum CandidateStatus
+{
+  CANDIDATE_IMPOSSIBLE, // the digit is in the cell in no solution
+  CANDIDATE_POSSIBLE,   // the digit is in the cell in some solutions but not all
+  CANDIDATE_FORCED      // the digit is in the cell in every solution (the board's backbone)
+};
+
+/**
+ * The result of a backbone analysis.
+ *
+ * candidates - the status of each digit in each cell, indexed [row * 9 + column][digit - 1].
+ *              A given is forced, and every other digit of its cell impossible.
+ * forced_cells - the number of empty cells whose digit is the same in every solution.
+ * solutions - the number of solutions found along the way, each of which marked all 81 of
+ *             its digits as possible at once.
+ * probes - the number of searches run with one candidate placed, to find out whether it
+ *          appears in any solution.
+ * refuted - how many of those probes found no solution, proving their candidate impossible.
+ * nodes - the number of digits placed, summed over every search.
+ */
+struct Backbone
+{
+  CandidateStatus candidates[81][9];
+  int forced_cells;
+  int solutions;
+  int probes;
+  int refuted;
+  long long nodes;
+};
+
+
+
+
+/**
+ * Finds, for every empty cell, which digits are forced, possible or impossible.
+ *
+ * A digit is possible in a cell if at least one solution puts it there, and forced if
+ * every solution does, i.e. if it is the only possible digit of its cell. Rather than
+ * solving the board once per candidate, each solution found marks the digit it holds in
+ * every cell as possible, so one search can settle up to 81 candidates. Only candidates
+ * that no solution has covered yet are probed, by placing the digit and looking for any
+ * solution: one that turns up marks its own digits possible in turn, and a probe that
+ * finds none proves its candidate impossible. Probes are shared out among the threads,
+ * and skip candidates that another thread's solution has already covered.
+ *
+ * The candidate map does not depend on the number of threads, but the counters do.
+ *
+ * @param board - a 9x9 character array representing the sudoku board.
+ * @param threads - the number of threads to run the probes on (at least 1).
+ * @param backbone - filled in with the candidate map and the counters.
+ *
+ * @return true - if the board has a solution, otherwise false (and every candidate is
+ *         marked impossible).
+ */
+bool analyse_backbone(const char board[9][9], int threads, Backbone& backbone);
+
+
+
+
+/**
+ * Finds the forced, possible and impossible digits of every cell of a sudoku variant.
+ *
+ * This is analyse_backbone with the units (and killer cages) of a topology.
+ *
+ * @param board - a 9x9 character array representing the sudoku board.
+ * @param topology - the units of the variant.
+ * @param threads - the number of threads to run the probes on (at least 1).
+ * @param backbone - filled in with the candidate map and the counters.
+ *
+ * @return true - if the board has a solution, otherwise false.
+ */
+bool analyse_backbone(const char board[9][9], const Topology& topology, int threads,
+                      Backbone& backbone);
+
+#endif
@@ -0,0 +1,393 @@
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include "checkpoint.h"
+
+using namespace std;
+
+/* INTERNAL HELPERS */
+
+static const char CHECKPOINT_MAGIC[4] = { 'S', 'D', 'K', 'C' };
+static const unsigned char CHECKPOINT_VERSION = 2;
+
+// Version 1 files have no topology fingerprint and are always classic searches
+static const unsigned char CHECKPOINT_VERSION_CLASSIC = 1;
+static const unsigned char FLAG_AT_SOLUTION = 1;
+static const unsigned char FLAG_FINISHED = 2;
+
+// Largest possible file: header, three counters, fingerprint, puzzle, full trail and checksum
+static const int CHECKPOINT_MAX_SIZE = 8 + 4 * 8 + 81 + 82 + 4;
+
+/**
+ * Computes the 32-bit FNV-1a hash of a block of bytes, used as the checkpoint checksum.
+ */
+static unsigned int checksum(const unsigned char* data, size_t length)
+{
+  unsigned int hash = 2166136261u;
+  for (size_t i = 0; i < length; i++)
+  {
+    hash = (hash ^ data[i]) * 16777619u;
+  }
+  return hash;
+}
+
+/**
+ * Appends an integer to a buffer in little-endian byte order.
+ */
+static void put_integer(unsigned char* buffer, size_t& length, unsigned long long value, int bytes)
+{
+  for (int i = 0; i < bytes; i++)
+  {
+    buffer[length++] = (unsigned char) (value >> (8 * i));
+  }
+}
+
+/**
+ * Reads a little-endian integer from a buffer.
+ */
+static unsigned long long get_integer(const unsigned char* buffer, size_t& position, int bytes)
+{
+  unsigned long long value = 0;
+  for (int i = 0; i < bytes; i++)
+  {
+    value |= (unsigned long long) buffer[position++] << (8 * i);
+  }
+  return value;
+}
+
+// A delivery journal entry: the journal key, the nodes of the checkpoint it follows and the
+// number of solutions delivered
+static const int JOURNAL_SIZE = 3 * 8;
+
+/**
+ * Identifies the puzzle and topology of a search, so a journal left by another search is
+ * never trusted.
+ */
+static unsigned long long journal_key(const SearchState& state)
+{
+  char puzzle[9][9];
+  search_puzzle(state, puzzle);
+  unsigned long long hash = 14695981039346656037ull;
+  for (int cell = 0; cell < 81; cell++)
+  {
+    hash = (hash ^ (unsigned char) puzzle[cell / 9][cell % 9]) * 1099511628211ull;
+  }
+  return hash ^ topology_fingerprint(*state.topology);
+}
+
+/**
+ * Overwrites the delivery journal with the current counts.
+ *
+ * @return true - if the entry was written, otherwise false.
+ */
+static bool write_journal(const CheckpointPolicy& policy)
+{
+  unsigned char buffer[JOURNAL_SIZE];
+  size_t length = 0;
+  put_integer(buffer, length, policy.journal_key, 8);
+  put_integer(buffer, length, policy.saved_nodes, 8);
+  put_integer(buffer, length, policy.delivered, 8);
+  return pwrite(policy.journal, buffer, length, 0) == (ssize_t) length;
+}
+
+/* SEARCH CHECKPOINTS */
+
+/**
+ * Saves a search state to a compact checkpoint file.
+ *
+ * @param filename - a constant character pointer to the checkpoint-file path.
+ * @param state - the search state to save; it should come from search_run or search_next.
+ *
+ * @return SUDOKU_OK - if the checkpoint was saved, otherwise the code describing the failure.
+ */
+SudokuStatus save_checkpoint(const char* filename, const SearchState& state)
+{
+  if (!filename)
+  {
+    return SUDOKU_ERROR_INVALID_ARGUMENT;
+  }
+
+  unsigned char buffer[CHECKPOINT_MAX_SIZE];
+  size_t length = 0;
+
+  memcpy(buffer, CHECKPOINT_MAGIC, 4);
+  length = 4;
+  buffer[length++] = CHECKPOINT_VERSION;
+  buffer[length++] = (state.at_solution ? FLAG_AT_SOLUTION : 0) | (state.finished ? FLAG_FINISHED : 0);
+  buffer[length++] = (unsigned char) state.depth;
+  buffer[length++] = (unsigned char) state.base_depth;
+  put_integer(buffer, length, state.nodes, 8);
+  put_integer(buffer, length, state.backtracks, 8);
+  put_integer(buffer, length, state.solutions, 8);
+  put_integer(buffer, length, topology_fingerprint(*state.topology), 8);
+
+  char puzzle[9][9];
+  search_puzzle(state, puzzle);
+  memcpy(buffer + length, puzzle, 81);
+  length += 81;
+
+  // The digit last tried at the current depth is part of the state too, unless the board is full
+  const int trail_length = state.depth + (state.depth < state.empty_count ? 1 : 0);
+  memcpy(buffer + length, state.trail, trail_length);
+  length += trail_length;
+  put_integer(buffer, length, checksum(buffer, length), 4);
+
+  // Write a temporary file and rename it over the old checkpoint once it is safely on disk
+  const string temporary = string(filename) + ".tmp";
+  FILE* out = fopen(temporary.c_str(), "wb");
+  if (!out)
+  {
+    return SUDOKU_ERROR_OPEN_FAILED;
+  }
+  const bool written = fwrite(buffer, 1, length, out) == length && fflush(out) == 0 &&
+                       fsync(fileno(out)) == 0;
+  if (fclose(out) != 0 || !written || rename(temporary.c_str(), filename) != 0)
+  {
+    remove(temporary.c_str());
+    return SUDOKU_ERROR_WRITE_FAILED;
+  }
+  return SUDOKU_OK;
+}
+
+/**
+ * Loads a search state from a checkpoint file.
+ *
+ * @param filename - a constant character pointer to the checkpoint-file path.
+ * @param state - the search state to fill in; it is only changed if the file is valid.
+ *
+ * @return SUDOKU_OK - if the checkpoint was loaded, SUDOKU_ERROR_OPEN_FAILED if it does not
+ *         exist, or SUDOKU_ERROR_CORRUPT_CHECKPOINT if it is damaged or does not fit.
+ */
+SudokuStatus load_checkpoint(const char* filename, SearchState& state)
+{
+  return load_checkpoint(filename, classic_topology(), state);
+}
+
+/**
+ * Loads a search state of a sudoku variant from a checkpoint file.
+ *
+ * @param filename - a constant character pointer to the checkpoint-file path.
+ * @param topology - the units of the variant; it must outlive the search.
+ * @param state - the search state to fill in; it is only changed if the file is valid.
+ *
+ * @return SUDOKU_OK - if the checkpoint was loaded, SUDOKU_ERROR_OPEN_FAILED if it does not
+ *         exist, or SUDOKU_ERROR_CORRUPT_CHECKPOINT if it is damaged or does not fit.
+ */
+SudokuStatus load_checkpoint(const char* filename, const Topology& topology, SearchState& state)
+{
+  if (!filename)
+  {
+    return SUDOKU_ERROR_INVALID_ARGUMENT;
+  }
+
+  FILE* in = fopen(filename, "rb");
+  if (!in)
+  {
+    return SUDOKU_ERROR_OPEN_FAILED;
+  }
+  unsigned char buffer[CHECKPOINT_MAX_SIZE + 1];
+  const size_t length = fread(buffer, 1, sizeof(buffer), in);
+  fclose(in);
+
+  // Check the header and the checksum before trusting anything else in the file
+  const bool fingerprinted = length > 4 && buffer[4] == CHECKPOINT_VERSION;
+  const size_t header = 8 + (fingerprinted ? 4 : 3) * 8 + 81;
+  if (length < header + 4 || length > (size_t) CHECKPOINT_MAX_SIZE ||
+      memcmp(buffer, CHECKPOINT_MAGIC, 4) != 0 ||
+      (buffer[4] != CHECKPOINT_VERSION && buffer[4] != CHECKPOINT_VERSION_CLASSIC))
+  {
+    return SUDOKU_ERROR_CORRUPT_CHECKPOINT;
+  }
+  size_t position = length - 4;
+  if (get_integer(buffer, position, 4) != checksum(buffer, length - 4))
+  {
+    return SUDOKU_ERROR_CORRUPT_CHECKPOINT;
+  }
+
+  position = 5;
+  const unsigned char flags = buffer[position++];
+  const int depth = buffer[position++];
+  const int base_depth = buffer[position++];
+  const long long nodes = get_integer(buffer, position, 8);
+  const long long backtracks = get_integer(buffer, position, 8);
+  const long long solutions = get_integer(buffer, position, 8);
+
+  // A search can only be resumed under the units it was started with
+  const unsigned long long fingerprint = fingerprinted ? get_integer(buffer, position, 8) :
+                                         topology_fingerprint(classic_topology());
+  if (fingerprint != topology_fingerprint(topology))
+  {
+    return SUDOKU_ERROR_CORRUPT_CHECKPOINT;
+  }
+
+  char puzzle[9][9];
+  memcpy(puzzle, buffer + position, 81);
+  position += 81;
+
+  char trail[82] = {};
+  const size_t trail_length = length - 4 - position;
+  memcpy(trail, buffer + position, trail_length);
+
+  // Replay the trail onto the puzzle, which also checks it fits
+  SearchState restored;
+  if (trail_length < (size_t) depth || trail_length > (size_t) depth + 1 ||
+      !search_restore(restored, puzzle, topology, trail, depth, base_depth) ||
+      trail_length != (size_t) (depth + (depth < restored.empty_count ? 1 : 0)))
+  {
+    return SUDOKU_ERROR_CORRUPT_CHECKPOINT;
+  }
+  restored.at_solution = (flags & FLAG_AT_SOLUTION) != 0;
+  restored.finished = (flags & FLAG_FINISHED) != 0;
+  restored.nodes = nodes;
+  restored.backtracks = backtracks;
+  restored.solutions = solutions;
+
+  state = restored;
+  return SUDOKU_OK;
+}
+
+/**
+ * Sets up a checkpoint policy for a search and opens its delivery journal.
+ *
+ * @param policy - the policy to set up.
+ * @param filename - the checkpoint-file path.
+ * @param interval - the number of digits placed between checkpoints (at least 1).
+ * @param state - the search the policy will be used with.
+ *
+ * @return SUDOKU_OK - if the policy was set up, otherwise the code describing the failure.
+ */
+SudokuStatus checkpoint_policy_init(CheckpointPolicy& policy, const char* filename,
+                                    long long interval, const SearchState& state)
+{
+  policy.journal = -1;
+  if (!filename)
+  {
+    return SUDOKU_ERROR_INVALID_ARGUMENT;
+  }
+  policy.filename = filename;
+  policy.interval = interval > 0 ? interval : 1;
+  policy.next_at = state.nodes + policy.interval;
+  policy.journal_key = journal_key(state);
+  policy.saved_nodes = state.nodes;
+  policy.delivered = state.solutions;
+
+  const string journal = string(filename) + ".delivered";
+  policy.journal = open(journal.c_str(), O_RDWR | O_CREAT, 0644);
+  if (policy.journal < 0)
+  {
+    return SUDOKU_ERROR_OPEN_FAILED;
+  }
+
+  // Trust the journal only if it follows this very checkpoint of this very search
+  unsigned char buffer[JOURNAL_SIZE];
+  if (pread(policy.journal, buffer, JOURNAL_SIZE, 0) == JOURNAL_SIZE)
+  {
+    size_t position = 0;
+    const unsigned long long key = get_integer(buffer, position, 8);
+    const long long nodes = (long long) get_integer(buffer, position, 8);
+    const long long delivered = (long long) get_integer(buffer, position, 8);
+    if (key == policy.journal_key && nodes == state.nodes && delivered > state.solutions)
+    {
+      policy.delivered = delivered;
+    }
+  }
+  return SUDOKU_OK;
+}
+
+/**
+ * Closes the delivery journal of a checkpoint policy.
+ *
+ * @param policy - the policy to close.
+ */
+void checkpoint_policy_close(CheckpointPolicy& policy)
+{
+  if (policy.journal >= 0)
+  {
+    close(policy.journal);
+    policy.journal = -1;
+  }
+}
+
+/**
+ * Advances a search to its next undelivered solution, saving a checkpoint at every interval.
+ *
+ * @param state - the search state to advance.
+ * @param policy - the checkpoint policy.
+ * @param found - set to true if a solution was found, otherwise false.
+ *
+ * @return SUDOKU_OK - unless a checkpoint could not be saved.
+ */
+SudokuStatus search_next_checkpointed(SearchState& state, CheckpointPolicy& policy, bool& found)
+{
+  found = false;
+  while (true)
+  {
+    const long long budget = policy.next_at > state.nodes ? policy.next_at - state.nodes : 1;
+    const SearchResult result = search_run(state, budget);
+
+    if (result == SEARCH_FOUND)
+    {
+      // A solution an earlier run delivered after its last checkpoint is found again here
+      if (state.solutions <= policy.delivered)
+      {
+        continue;
+      }
+      found = true;
+      return SUDOKU_OK;
+    }
+    if (result == SEARCH_EXHAUSTED)
+    {
+      return checkpoint_save(policy, state);
+    }
+
+    // The budget ran out: save where we are and carry on
+    const SudokuStatus status = checkpoint_save(policy, state);
+    if (status != SUDOKU_OK)
+    {
+      return status;
+    }
+    policy.next_at = state.nodes + policy.interval;
+  }
+}
+
+/**
+ * Records in the delivery journal that the current solution has been delivered.
+ *
+ * @param policy - the checkpoint policy.
+ * @param state - the search, at the solution just delivered.
+ *
+ * @return SUDOKU_OK - if the journal was updated, otherwise SUDOKU_ERROR_WRITE_FAILED.
+ */
+SudokuStatus checkpoint_delivered(CheckpointPolicy& policy, const SearchState& state)
+{
+  policy.delivered = state.solutions;
+  return write_journal(policy) ? SUDOKU_OK : SUDOKU_ERROR_WRITE_FAILED;
+}
+
+/**
+ * Saves a checkpoint of a search under its policy, keeping the delivery journal in step.
+ *
+ * @param policy - the checkpoint policy.
+ * @param state - the search state to save.
+ *
+ * @return SUDOKU_OK - if the checkpoint was saved, otherwise the code describing the failure.
+ */
+SudokuStatus checkpoint_save(CheckpointPolicy& policy, const SearchState& state)
+{
+  const SudokuStatus status = save_checkpoint(policy.filename, state);
+  if (status != SUDOKU_OK)
+  {
+    return status;
+  }
+
+  // Until this entry is written the journal still names the old checkpoint, which makes a
+  // resume ignore it; that is right, as nothing has been delivered since the new one
+  policy.saved_nodes = state.nodes;
+  if (policy.delivered < state.solutions)
+  {
+    policy.delivered = state.solutions;
+  }
+  return write_journal(policy) ? SUDOKU_OK : SUDOKU_ERROR_WRITE_FAILED;
+}
@@ -0,0 +1,176 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "sudoku.h"
+#include "search.h"
+
+/* SEARCH CHECKPOINTS */
+
+/**
+ * Saves a search state to a compact checkpoint file.
+ *
+ * The file holds the puzzle, the digits on the trail, the search flags, its counters and a
+ * fingerprint of its topology (about 200 bytes) plus a checksum. It is written to a temporary file which is
+ * then renamed over the old checkpoint, so a crash while saving never leaves a torn file.
+ *
+ * @param filename - a constant character pointer to the checkpoint-file path.
+ * @param state - the search state to save; it should come from search_run or search_next.
+ *
+ * @return SUDOKU_OK - if the checkpoint was saved, otherwise the code describing the failure.
+ */
+SudokuStatus save_checkpoint(const char* filename, const SearchState& state);
+
+
+
+
+/**
+ * Loads a search state from a checkpoint file.
+ *
+ * Resuming the loaded state carries on exactly where the saved search stopped: no
+ * part of the search tree is explored twice or skipped, and the counters continue
+ * from their saved values.
+ *
+ * @param filename - a constant character pointer to the checkpoint-file path.
+ * @param state - the search state to fill in; it is only changed if the file is valid.
+ *
+ * @return SUDOKU_OK - if the checkpoint was loaded, SUDOKU_ERROR_OPEN_FAILED if it does not
+ *         exist, or SUDOKU_ERROR_CORRUPT_CHECKPOINT if it is damaged or does not fit.
+ */
+SudokuStatus load_checkpoint(const char* filename, SearchState& state);
+
+
+
+
+/**
+ * Loads a search state of a sudoku variant from a checkpoint file.
+ *
+ * The checkpoint must have been saved from a search with the same units; one saved
+ * under any other topology is rejected as not fitting.
+ *
+ * @param filename - a constant character pointer to the checkpoint-file path.
+ * @param topology - the units of the variant; it must outlive the search.
+ * @param state - the search state to fill in; it is only changed if the file is valid.
+ *
+ * @return SUDOKU_OK - if the checkpoint was loaded, SUDOKU_ERROR_OPEN_FAILED if it does not
+ *         exist, or SUDOKU_ERROR_CORRUPT_CHECKPOINT if it is damaged or does not fit.
+ */
+SudokuStatus load_checkpoint(const char* filename, const Topology& topology, SearchState& state);
+
+
+
+
+/**
+ * When and where a long-running search saves its checkpoints, and how many of its solutions
+ * have been delivered.
+ *
+ * A checkpoint is only saved every interval placements, but a run can be killed at any
+ * moment, so the solutions delivered since the last checkpoint are also counted in a small
+ * delivery journal next to it (the checkpoint path with ".delivered" added). The journal is
+ * updated in place after every delivered solution, which is cheap because it is never
+ * synced; it only has to survive the process, not the machine. On resuming, the solutions
+ * the journal says were already delivered are found again and passed over, so each solution
+ * is delivered exactly once however the earlier run ended.
+ *
+ * filename - the checkpoint-file path.
+ * interval - the number of digits placed between checkpoints.
+ * next_at - the value of state.nodes at which the next checkpoint is due.
+ * journal - the open descriptor of the delivery journal.
+ * journal_key - identifies the puzzle and topology the journal belongs to.
+ * saved_nodes - the value of state.nodes in the last checkpoint (or at the start).
+ * delivered - the number of solutions delivered so far, counting earlier runs.
+ */
+struct CheckpointPolicy
+{
+  const char* filename;
+  long long interval;
+  long long next_at;
+  int journal;
+  unsigned long long journal_key;
+  long long saved_nodes;
+  long long delivered;
+};
+
+
+
+
+/**
+ * Sets up a checkpoint policy for a search and opens its delivery journal.
+ *
+ * If the journal records solutions delivered after the checkpoint the search was loaded
+ * from (or after the start of the search, if there was no checkpoint yet), policy.delivered
+ * is set past them.
+ *
+ * @param policy - the policy to set up; it must be closed with checkpoint_policy_close.
+ * @param filename - the checkpoint-file path.
+ * @param interval - the number of digits placed between checkpoints (at least 1).
+ * @param state - the search the policy will be used with, fresh or just loaded.
+ *
+ * @return SUDOKU_OK - if the policy was set up, otherwise SUDOKU_ERROR_INVALID_ARGUMENT or
+ *         SUDOKU_ERROR_OPEN_FAILED (the journal could not be opened).
+ */
+SudokuStatus checkpoint_policy_init(CheckpointPolicy& policy, const char* filename,
+                                    long long interval, const SearchState& state);
+
+
+
+
+/**
+ * Closes the delivery journal of a checkpoint policy.
+ *
+ * @param policy - the policy to close.
+ */
+void checkpoint_policy_close(CheckpointPolicy& policy);
+
+
+
+
+/**
+ * Advances a search to its next undelivered solution, saving a checkpoint at every interval.
+ *
+ * Solutions already delivered by an earlier run are passed over. A final checkpoint is saved
+ * when the search runs out of solutions, so a finished search is never repeated.
+ *
+ * The caller must deliver each solution (write it out and flush it) and then call
+ * checkpoint_delivered before asking for the next one, because a checkpoint saved later
+ * counts it as delivered.
+ *
+ * @param state - the search state to advance.
+ * @param policy - the checkpoint policy.
+ * @param found - set to true if a solution was found, otherwise false.
+ *
+ * @return SUDOKU_OK - unless a checkpoint could not be saved.
+ */
+SudokuStatus search_next_checkpointed(SearchState& state, CheckpointPolicy& policy, bool& found);
+
+
+
+
+/**
+ * Records in the delivery journal that the current solution has been delivered.
+ *
+ * Only a process killed between flushing the solution and this call can deliver that one
+ * solution again when resumed.
+ *
+ * @param policy - the checkpoint policy.
+ * @param state - the search, at the solution just delivered.
+ *
+ * @return SUDOKU_OK - if the journal was updated, otherwise SUDOKU_ERROR_WRITE_FAILED.
+ */
+SudokuStatus checkpoint_delivered(CheckpointPolicy& policy, const SearchState& state);
+
+
+
+
+/**
+ * Saves a checkpoint of a search under its policy, e.g. when a run stops early, keeping
+ * the delivery journal in step with it.
+ *
+ * @param policy - the checkpoint policy.
+ * @param state - the search state to save; every solution it has counted must have been
+ *        delivered.
+ *
+ * @return SUDOKU_OK - if the checkpoint was saved, otherwise the code describing the failure.
+ */
+SudokuStatus checkpoint_save(CheckpointPolicy& policy, const SearchState& state);
+
+#endif
@@ -0,0 +1,1402 @@
+#include <algorithm>
+#include <csignal>
+#include <ctime>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "sudoku.h"
+#include "preflight.h"
+#include "enumerate.h"
+#include "checkpoint.h"
+#include "shard.h"
+#include "solution_db.h"
+#include "killer.h"
+#include "resolve.h"
+#include "backbone.h"
+#include "corpus_io.h"
+#include "reduce.h"
+#include "result_writer.h"
+#include "shm_ring.h"
+#include "perf_counters.h"
+#include "cli.h"
+
+using namespace std;
+
+/* SOLVER ENGINES */
+
+/**
+ * A named way of solving a board, so every engine can be measured the same way.
+ */
+struct Engine
+{
+  const char* name;
+  bool (*solve)(char board[9][9], const Topology& topology);
+};
+
+/**
+ * Solves the board with the plain recursive backtracking solver.
+ */
+static bool solve_backtracking(char board[9][9], const Topology& topology)
+{
+  // The classic solver checks subgrids directly, which is faster than walking the unit tables
+  if (&topology == &classic_topology())
+  {
+    return solve_board(board);
+  }
+  return solve_board(board, topology);
+}
+
+/**
+ * Rejects contradictory boards with the preflight check before backtracking.
+ */
+static bool solve_with_preflight(char board[9][9], const Topology& topology)
+{
+  if (preflight_board(board, topology).reason != PREFLIGHT_OK)
+  {
+    return false;
+  }
+  return solve_backtracking(board, topology);
+}
+
+/**
+ * Solves the board with the resumable bitmask search behind the solution generators.
+ */
+static bool solve_resumable(char board[9][9], const Topology& topology)
+{
+  SearchState state;
+  search_init(state, board, topology);
+  if (!search_next(state))
+  {
+    return false;
+  }
+  memcpy(board, state.board, 81);
+  return true;
+}
+
+/**
+ * Returns the topology the engines should solve under: the shared classic topology if the
+ * given one has exactly the classic units, so they can take their classic paths, and the
+ * given one otherwise.
+ */
+static const Topology& engine_topology(const Topology& topology)
+{
+  const Topology& classic = classic_topology();
+  return topology_fingerprint(topology) == topology_fingerprint(classic) ? classic : topology;
+}
+
+static const Engine ENGINES[] = {
+  { "backtracking", solve_backtracking },
+  { "preflight+backtracking", solve_with_preflight },
+  { "resumable-search", solve_resumable }
+};
+static const int ENGINE_COUNT = sizeof(ENGINES) / sizeof(ENGINES[0]);
+
+/* INTERNAL HELPERS */
+
+/**
+ * The options shared by the command-line modes.
+ *
+ * perf - whether to record hardware counters (--perf).
+ * limit - the maximum number of results to produce, or 0 for no limit (--limit N).
+ * threads - the number of worker threads to use (--threads T).
+ * checkpoint - the checkpoint file to save to and resume from, if any (--checkpoint FILE).
+ * interval - the number of placements between checkpoints (--interval N).
+ * prefix - the number of decisions fixed in each shard (--prefix K).
+ * workers - the number of worker processes (--workers W).
+ * capacity - the number of slots in a new solution database or solver ring (--capacity N).
+ * output - the file batch writes its results to, if any (--output FILE).
+ * write_thread - whether batch writes its results on a thread of its own (--write-thread).
+ * database - the solution database batch adds its puzzles to, if any (--db FILE).
+ * table_megabytes - the memory for count's transposition table, or 0 for none (--table MB).
+ * topology - the units of the variant to solve: a jigsaw region map
+ *            (--regions FILE) and/or the two main diagonals (--diagonals), otherwise classic.
+ * arguments - everything that is not an option, usually file names.
+ */
+struct Options
+{
+  bool perf;
+  long long limit;
+  int threads;
+  string checkpoint;
+  long long interval;
+  int prefix;
+  int workers;
+  unsigned long long capacity;
+  string output;
+  bool write_thread;
+  string database;
+  long long table_megabytes;
+  Topology topology;
+  vector<string> arguments;
+};
+
+/**
+ * Parses one line of a corpus file into a board.
+ *
+ * @param line - the line, which must start with 81 cells ('1'-'9', or '.' or '0' for empty).
+ * @param board - a 9x9 character array that will hold the puzzle.
+ *
+ * @return true - if the line held a puzzle, otherwise false.
+ */
+static bool parse_corpus_line(const string& line, char board[9][9])
+{
+  return line.size() >= 81 && parse_board(line.data(), line.size(), board) == SUDOKU_OK;
+}
+
+/**
+ * Opens a corpus file (plain, gzip or zstd) for streaming, reporting an error if it cannot
+ * be opened.
+ *
+ * @param corpus - the corpus-file path.
+ * @param reader - the reader to open.
+ *
+ * @return true - if the corpus was opened, otherwise false.
+ */
+static bool open_corpus(const string& corpus, CorpusReader& reader)
+{
+  const SudokuStatus status = corpus_open(corpus.c_str(), reader);
+  if (status != SUDOKU_OK)
+  {
+    cerr << "Cannot open corpus '" << corpus << "': " << sudoku_status_message(status) << ".\n";
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Reads up to the next puzzle line of a corpus, skipping lines that hold no puzzle.
+ *
+ * @param reader - an open corpus reader.
+ * @param puzzles - a vector that the puzzle is appended to as its first 81 characters.
+ *
+ * @return true - if a puzzle was read, otherwise false at the end of the corpus.
+ */
+static bool read_puzzle(CorpusReader& reader, vector<string>& puzzles)
+{
+  string line;
+  while (corpus_read_line(reader, line))
+  {
+    char board[9][9];
+    if (parse_corpus_line(line, board))
+    {
+      puzzles.push_back(line.substr(0, 81));
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Closes a corpus, reporting an error if it stopped before its end.
+ *
+ * @param corpus - the corpus-file path.
+ * @param reader - the reader, after its last line has been read.
+ *
+ * @return true - if the whole corpus was read, otherwise false.
+ */
+static bool close_corpus(const string& corpus, CorpusReader& reader)
+{
+  corpus_close(reader);
+  if (reader.status != SUDOKU_OK)
+  {
+    cerr << "Cannot read corpus '" << corpus << "': " << sudoku_status_message(reader.status)
+         << ".\n";
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Reads every puzzle line of a corpus file, reporting an error if it cannot be read.
+ *
+ * @param corpus - the corpus-file path.
+ * @param puzzles - a vector that each puzzle is appended to as its first 81 characters.
+ *
+ * @return true - if the corpus was read, otherwise false.
+ */
+static bool read_corpus(const string& corpus, vector<string>& puzzles)
+{
+  CorpusReader reader;
+  if (!open_corpus(corpus, reader))
+  {
+    return false;
+  }
+  while (read_puzzle(reader, puzzles))
+  {
+  }
+  return close_corpus(corpus, reader);
+}
+
+/**
+ * Returns the current monotonic wall-clock time in nanoseconds.
+ */
+static long long now_ns()
+{
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (long long) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * Returns a percentile of some measurements, sorting them.
+ */
+static long long percentile(vector<long long>& values, double fraction)
+{
+  if (values.empty())
+  {
+    return 0;
+  }
+  sort(values.begin(), values.end());
+  return values[(size_t) (fraction * (values.size() - 1))];
+}
+
+/**
+ * Copies one board into another.
+ */
+static void copy_board(const char from[9][9], char to[9][9])
+{
+  memcpy(to, from, 81);
+}
+
+/**
+ * Prints the header line for the per-board measurement table.
+ *
+ * @param perf - whether hardware counter columns are printed.
+ */
+static void print_header(bool perf)
+{
+  cout << left << setw(24) << "board" << setw(24) << "engine" << setw(8) << "solved"
+       << right << setw(12) << "time(us)";
+  if (perf)
+  {
+    for (int event = 0; event < PERF_EVENT_COUNT; event++)
+    {
+      cout << setw(15) << perf_event_name(event);
+    }
+    cout << setw(7) << "IPC";
+  }
+  cout << '\n';
+}
+
+/**
+ * Prints one row of the measurement table.
+ *
+ * @param label - the board (or total) the row describes.
+ * @param engine - the name of the engine that was measured.
+ * @param solved - a description of the outcome, e.g. "yes", "no" or "12/12".
+ * @param sample - the measured sample.
+ * @param perf - whether hardware counter columns are printed.
+ */
+static void print_measurement(const string& label, const char* engine, const string& solved,
+                              const PerfSample& sample, bool perf)
+{
+  cout << left << setw(24) << label << setw(24) << engine << setw(8) << solved
+       << right << setw(12) << fixed << setprecision(1) << sample.seconds * 1e6;
+  if (perf)
+  {
+    for (int event = 0; event < PERF_EVENT_COUNT; event++)
+    {
+      if (sample.valid[event])
+      {
+        cout << setw(15) << sample.values[event];
+      }
+      else
+      {
+        cout << setw(15) << "n/a";
+      }
+    }
+    if (sample.valid[PERF_CYCLES] && sample.valid[PERF_INSTRUCTIONS] && sample.values[PERF_CYCLES])
+    {
+      cout << setw(7) << setprecision(2)
+           << (double) sample.values[PERF_INSTRUCTIONS] / sample.values[PERF_CYCLES];
+    }
+    else
+    {
+      cout << setw(7) << "n/a";
+    }
+  }
+  cout << '\n';
+}
+
+/**
+ * Opens the hardware counters if requested, warning when none are available.
+ *
+ * @param counters - the counter set to open.
+ * @param perf - whether counters were requested; when false every counter is left closed.
+ */
+static void open_counters(PerfCounters& counters, bool perf)
+{
+  for (int event = 0; event < PERF_EVENT_COUNT; event++)
+  {
+    counters.fds[event] = -1;
+  }
+  if (perf && perf_open(counters) < PERF_EVENT_COUNT)
+  {
+    cerr << "Warning: some hardware counters are unavailable and are reported as n/a.\n";
+  }
+}
+
+/**
+ * Opens a solution database for adding records, creating it with the configured number of
+ * slots if it does not exist yet, and reports an error if that fails.
+ *
+ * @param database - the database-file path.
+ * @param options - the parsed options (capacity and topology).
+ * @param db - the database handle to fill in.
+ *
+ * @return true - if the database is open, otherwise false.
+ */
+static bool open_database(const string& database, const Options& options, SolutionDb& db)
+{
+  SudokuStatus status = solution_db_create(database.c_str(), options.capacity, options.topology);
+  if (status != SUDOKU_OK && status != SUDOKU_ERROR_OPEN_FAILED)
+  {
+    cerr << "Cannot create '" << database << "': " << sudoku_status_message(status) << ".\n";
+    return false;
+  }
+  status = solution_db_open(database.c_str(), true, options.topology, db);
+  if (status != SUDOKU_OK)
+  {
+    cerr << "Cannot open '" << database << "': " << sudoku_status_message(status) << ".\n";
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Solves a puzzle and appends its record to a solution database, unless the database
+ * already holds it.
+ *
+ * @param db - a database opened for writing.
+ * @param board - the puzzle.
+ * @param topology - the units of the variant.
+ * @param added - set to true if a record was added, false if one was already present.
+ *
+ * @return SUDOKU_OK - if the puzzle is in the database afterwards, otherwise the failure.
+ */
+static SudokuStatus store_record(SolutionDb& db, const char board[9][9], const Topology& topology,
+                                 bool& added)
+{
+  SolutionRecord record;
+  added = false;
+  if (solution_db_lookup(db, board, record))
+  {
+    return SUDOKU_OK;
+  }
+  solution_record_compute(board, topology, 2, record);
+  const SudokuStatus status = solution_db_insert(db, board, record);
+  added = status == SUDOKU_OK;
+  return status;
+}
+
+/* MODES */
+
+/**
+ * Solves each board file with every engine, reporting time and counters per board. The
+ * boards are solved under the variant's topology, with any killer cages their files add.
+ */
+static int bench_command(const vector<string>& files, const Options& options)
+{
+  const bool perf = options.perf;
+  PerfCounters counters;
+  open_counters(counters, perf);
+  print_header(perf);
+  int failures = 0;
+
+  for (size_t i = 0; i < files.size(); i++)
+  {
+    char original[9][9];
+    Topology variant = options.topology;
+    const SudokuStatus status = read_killer_file(files[i].c_str(), original, variant);
+    if (status != SUDOKU_OK)
+    {
+      cerr << "Cannot load '" << files[i] << "': " << sudoku_status_message(status) << ".\n";
+      failures++;
+      continue;
+    }
+    const Topology& topology = engine_topology(variant);
+
+    for (int e = 0; e < ENGINE_COUNT; e++)
+    {
+      char board[9][9];
+      copy_board(original, board);
+
+      PerfSample sample;
+      perf_start(counters, sample);
+      const bool solved = ENGINES[e].solve(board, topology);
+      perf_stop(counters, sample);
+
+      print_measurement(files[i], ENGINES[e].name, solved ? "yes" : "no", sample, perf);
+    }
+  }
+
+  perf_close(counters);
+  return failures ? 1 : 0;
+}
+
+/**
+ * Solves every puzzle in a corpus with every engine, reporting each puzzle and the totals.
+ *
+ * The corpus is streamed during the first engine's pass, so its decompression overlaps with
+ * solving, and kept for the other engines. With --output the results go to a buffered result
+ * file laid out as its name asks: the first engine's solutions for .dat or line files, and
+ * every engine's measurements of every puzzle for .csv and .jsonl files. Names ending in .gz
+ * or .zst are compressed, and --write-thread moves the writing off the solving thread.
+ * With --db, every puzzle not yet in the solution database is added to it as it is streamed,
+ * as db-build would. The puzzles are solved under the variant's topology.
+ */
+static int batch_command(const string& corpus, const Options& options)
+{
+  CorpusReader reader;
+  if (!open_corpus(corpus, reader))
+  {
+    return 1;
+  }
+
+  ResultWriter writer;
+  const ResultFormat format = result_format_for_name(options.output.c_str());
+  const bool all_engines = format == RESULT_FORMAT_CSV || format == RESULT_FORMAT_JSONL;
+  if (!options.output.empty())
+  {
+    const SudokuStatus status = result_open(options.output.c_str(), format, options.write_thread,
+                                            writer);
+    if (status != SUDOKU_OK)
+    {
+      cerr << "Cannot create '" << options.output << "': " << sudoku_status_message(status)
+           << ".\n";
+      corpus_close(reader);
+      return 1;
+    }
+  }
+
+  SolutionDb db;
+  const bool use_db = !options.database.empty();
+  if (use_db && !open_database(options.database, options, db))
+  {
+    if (!options.output.empty())
+    {
+      result_close(writer);
+    }
+    corpus_close(reader);
+    return 1;
+  }
+  SudokuStatus db_status = SUDOKU_OK;
+  unsigned long long db_added = 0;
+
+  const Topology& topology = engine_topology(options.topology);
+  const bool perf = options.perf;
+  PerfCounters counters;
+  open_counters(counters, perf);
+  print_header(perf);
+
+  vector<string> puzzles;
+  for (int e = 0; e < ENGINE_COUNT; e++)
+  {
+    PerfSample total;
+    perf_clear_sample(total);
+    int solved_count = 0;
+
+    for (size_t i = 0; i < puzzles.size() || (e == 0 && read_puzzle(reader, puzzles)); i++)
+    {
+      char puzzle[9][9], board[9][9];
+      parse_corpus_line(puzzles[i], puzzle);
+      copy_board(puzzle, board);
+
+      PerfSample sample;
+      perf_start(counters, sample);
+      const bool solved = ENGINES[e].solve(board, topology);
+      perf_stop(counters, sample);
+
+      solved_count += solved;
+      perf_accumulate(total, sample);
+      print_measurement("#" + to_string(i + 1), ENGINES[e].name, solved ? "yes" : "no",
+                        sample, perf);
+
+      if ((e == 0 || all_engines) && !options.output.empty())
+      {
+        const ResultRecord record = { i + 1, ENGINES[e].name, puzzle, board, solved, sample };
+        result_write(writer, record);
+      }
+
+      // Records are added outside the measured solve, once per puzzle
+      if (e == 0 && use_db && db_status == SUDOKU_OK)
+      {
+        bool added;
+        db_status = store_record(db, puzzle, options.topology, added);
+        db_added += added;
+      }
+    }
+
+    print_measurement("total", ENGINES[e].name,
+                      to_string(solved_count) + "/" + to_string(puzzles.size()), total, perf);
+  }
+  perf_close(counters);
+
+  bool ok = close_corpus(corpus, reader);
+  cerr << "corpus: " << puzzles.size() << " puzzles, " << reader.file_bytes << " bytes read ("
+       << compression_name(reader.compression) << ", " << reader.data_bytes
+       << " bytes uncompressed)\n";
+  if (!options.output.empty())
+  {
+    const SudokuStatus status = result_close(writer);
+    if (status != SUDOKU_OK)
+    {
+      cerr << "Cannot write '" << options.output << "': " << sudoku_status_message(status)
+           << ".\n";
+      ok = false;
+    }
+    else
+    {
+      cerr << "output: " << writer.records << " " << result_format_name(writer.format)
+           << " records, " << writer.data_bytes << " bytes written as " << writer.file_bytes
+           << " (" << compression_name(writer.compression) << ")\n";
+    }
+  }
+  if (use_db)
+  {
+    if (db_status != SUDOKU_OK)
+    {
+      cerr << "Cannot add to '" << options.database << "': " << sudoku_status_message(db_status)
+           << ".\n";
+      ok = false;
+    }
+    cerr << "database: " << db_added << " added, " << solution_db_count(db) << " records in '"
+         << options.database << "'\n";
+    solution_db_close(db);
+  }
+  return ok ? 0 : 1;
+}
+
+/**
+ * Streams the solutions of a board while saving checkpoints, resuming from an existing one.
+ */
+static int enumerate_with_checkpoints(const char board[9][9], const Topology& topology,
+                                      const Options& options)
+{
+  const char* filename = options.checkpoint.c_str();
+  SearchState state;
+  SudokuStatus status = load_checkpoint(filename, topology, state);
+
+  if (status == SUDOKU_OK)
+  {
+    char puzzle[9][9];
+    search_puzzle(state, puzzle);
+    if (memcmp(puzzle, board, 81) != 0)
+    {
+      cerr << "Checkpoint '" << filename << "' belongs to a different board.\n";
+      return 1;
+    }
+  }
+  else if (status == SUDOKU_ERROR_OPEN_FAILED)
+  {
+    search_init(state, board, topology);
+  }
+  else
+  {
+    cerr << "Cannot load checkpoint '" << filename << "': " << sudoku_status_message(status) << ".\n";
+    return 1;
+  }
+
+  CheckpointPolicy policy;
+  status = checkpoint_policy_init(policy, filename, options.interval, state);
+  if (status != SUDOKU_OK)
+  {
+    cerr << "Cannot open the delivery journal of '" << filename << "': "
+         << sudoku_status_message(status) << ".\n";
+    return 1;
+  }
+  if (policy.delivered > 0)
+  {
+    cerr << "Resuming after " << policy.delivered << " delivered solutions (checkpoint at "
+         << state.solutions << " solutions and " << state.nodes << " placements).\n";
+  }
+
+  // Each solution is flushed before the journal counts it, so a run killed at any point
+  // resumes with neither a repeated nor a missing solution
+  bool found = false;
+  while (!options.limit || policy.delivered < options.limit)
+  {
+    status = search_next_checkpointed(state, policy, found);
+    if (status != SUDOKU_OK)
+    {
+      cerr << "Cannot save checkpoint '" << filename << "': " << sudoku_status_message(status) << ".\n";
+      checkpoint_policy_close(policy);
+      return 1;
+    }
+    if (!found)
+    {
+      break;
+    }
+    cout.write(&state.board[0][0], 81) << '\n';
+    cout.flush();
+    status = checkpoint_delivered(policy, state);
+    if (status != SUDOKU_OK)
+    {
+      cerr << "Cannot update the delivery journal of '" << filename << "': "
+           << sudoku_status_message(status) << ".\n";
+      checkpoint_policy_close(policy);
+      return 1;
+    }
+  }
+
+  // Record where the run stopped, so a later run with a higher limit carries on from here
+  status = checkpoint_save(policy, state);
+  checkpoint_policy_close(policy);
+  if (status != SUDOKU_OK)
+  {
+    cerr << "Cannot save checkpoint '" << filename << "': " << sudoku_status_message(status) << ".\n";
+    return 1;
+  }
+  cerr << state.solutions << " solutions (" << state.nodes << " placements, " << state.backtracks
+       << " backtracks)" << (state.finished ? ", search complete" : "") << "\n";
+  return 0;
+}
+
+/**
+ * Streams the solutions of a board, one 81-character line each, with a count at the end.
+ */
+static int enumerate_command(const string& file, const Options& options)
+{
+  // The board file may carry killer cages, which are added to the variant's units
+  char board[9][9];
+  Topology topology = options.topology;
+  const SudokuStatus status = read_killer_file(file.c_str(), board, topology);
+  if (status != SUDOKU_OK)
+  {
+    cerr << "Cannot load '" << file << "': " << sudoku_status_message(status) << ".\n";
+    return 1;
+  }
+
+  long long count = 0;
+  if (options.threads > 1 && !options.checkpoint.empty())
+  {
+    cerr << "Checkpoints are only supported for single-threaded enumeration.\n";
+    return 2;
+  }
+  if (options.threads > 1)
+  {
+    SearchState root;
+    search_init(root, board, topology);
+    mutex output;
+    count = enumerate_solutions_parallel(root, options.threads, options.limit,
+                                         [&output](const char solution[9][9])
+                                         {
+                                           lock_guard<mutex> lock(output);
+                                           cout.write(&solution[0][0], 81) << '\n';
+                                           return true;
+                                         });
+    cerr << count << " solutions\n";
+    return 0;
+  }
+
+  if (!options.checkpoint.empty())
+  {
+    return enumerate_with_checkpoints(board, topology, options);
+  }
+
+  SearchState state;
+  search_init(state, board, topology);
+  SolutionGenerator solutions = enumerate_solutions(state);
+  while ((!options.limit || count < options.limit) && solutions.next())
+  {
+    cout.write(&solutions.board()[0][0], 81) << '\n';
+    count++;
+  }
+  cerr << count << " solutions (" << solutions.state().nodes << " placements, "
+       << solutions.state().backtracks << " backtracks)\n";
+  return 0;
+}
+
+/**
+ * Searches a board in forked worker processes and prints the merged counts and a
+ * shard-balance report.
+ */
+static int shard_command(const string& file, const Options& options)
+{
+  char board[9][9];
+  Topology topology = options.topology;
+  const SudokuStatus status = read_killer_file(file.c_str(), board, topology);
+  if (status != SUDOKU_OK)
+  {
+    cerr << "Cannot load '" << file << "': " << sudoku_status_message(status) << ".\n";
+    return 1;
+  }
+
+  // This mode starts no threads of its own, as the forking search requires
+  ShardReport report;
+  const SudokuStatus run = run_sharded_search(board, topology, options.prefix,
+                                              options.workers, options.limit, report);
+  if (run != SUDOKU_OK)
+  {
+    cerr << "Sharded search failed: " << sudoku_status_message(run) << ".\n";
+    return 1;
+  }
+
+  for (size_t i = 0; i < report.solutions.size(); i++)
+  {
+    cout << report.solutions[i] << '\n';
+  }
+
+  // Shard balance: how evenly the work was spread over shards and workers
+  long long min_nodes = 0, max_nodes = 0;
+  int retried = 0;
+  double shard_seconds = 0, max_shard_seconds = 0;
+  for (size_t i = 0; i < report.shards.size(); i++)
+  {
+    const ShardOutcome& outcome = report.shards[i];
+    if (!i || outcome.nodes < min_nodes)
+    {
+      min_nodes = outcome.nodes;
+    }
+    max_nodes = max(max_nodes, outcome.nodes);
+    retried += outcome.attempts > 1;
+    shard_seconds += outcome.cpu_seconds;
+    max_shard_seconds = max(max_shard_seconds, outcome.cpu_seconds);
+  }
+  double busiest = 0, total_busy = 0;
+  for (size_t w = 0; w < report.worker_seconds.size(); w++)
+  {
+    busiest = max(busiest, report.worker_seconds[w]);
+    total_busy += report.worker_seconds[w];
+  }
+  const double mean_busy = total_busy / report.worker_seconds.size();
+
+  cout << fixed << setprecision(3)
+       << "solutions:        " << report.solution_count << '\n'
+       << "placements:       " << report.nodes << '\n'
+       << "backtracks:       " << report.backtracks << '\n'
+       << "shards:           " << report.shards.size() << " completed, "
+       << report.failed_shards << " failed, " << retried << " retried\n"
+       << "shard nodes:      min " << min_nodes << ", mean "
+       << (report.shards.empty() ? 0 : report.nodes / (long long) report.shards.size())
+       << ", max " << max_nodes << '\n'
+       << "longest shard:    " << max_shard_seconds << " s CPU\n";
+  for (size_t w = 0; w < report.worker_seconds.size(); w++)
+  {
+    int taken = 0;
+    for (size_t i = 0; i < report.shards.size(); i++)
+    {
+      taken += report.shards[i].worker == (int) w;
+    }
+    cout << "worker " << w << ":         " << taken << " shards, " << report.worker_seconds[w]
+         << " s busy\n";
+  }
+  cout << "imbalance:        " << (mean_busy > 0 ? busiest / mean_busy : 1.0)
+       << " (busiest worker / mean worker)\n"
+       << "wall time:        " << report.seconds << " s (" << shard_seconds
+       << " s CPU of shard work, speed-up " << (report.seconds > 0 ? shard_seconds / report.seconds : 0)
+       << ")\n";
+  return report.failed_shards ? 1 : 0;
+}
+
+/**
+ * Re-solves an edited board from the solution of the board before the edit, and compares
+ * the work done with a cold solve of the edited board.
+ */
+static int resolve_command(const string& previous_file, const string& edited_file,
+                           const Options& options)
+{
+  char previous[9][9], edited[9][9];
+  Topology topology = options.topology;
+  SudokuStatus status = read_board_file(previous_file.c_str(), previous);
+  if (status != SUDOKU_OK)
+  {
+    cerr << "Cannot load '" << previous_file << "': " << sudoku_status_message(status) << ".\n";
+    return 1;
+  }
+  status = read_killer_file(edited_file.c_str(), edited, topology);
+  if (status != SUDOKU_OK)
+  {
+    cerr << "Cannot load '" << edited_file << "': " << sudoku_status_message(status) << ".\n";
+    return 1;
+  }
+
+  static const char* const METHODS[] = { "reused", "repaired", "cold", "unsolvable" };
+  char solution[9][9];
+  ResolveReport report;
+  const bool found = resolve_board(edited, previous, topology, solution, report);
+  if (found)
+  {
+    cout.write(&solution[0][0], 81) << '\n';
+  }
+
+  SearchState cold;
+  search_init(cold, edited, topology);
+  search_next(cold);
+  cerr << "re-solve:   " << METHODS[report.method] << " after " << report.rounds << " searches, "
+       << report.freed_cells << " cells freed, " << report.nodes << " placements\n"
+       << "cold solve: " << cold.nodes << " placements\n";
+  return found ? 0 : 1;
+}
+
+/**
+ * Counts the solutions of a board, skipping repeated subtrees through a transposition table.
+ */
+static int count_command(const string& filename, const Options& options)
+{
+  char board[9][9];
+  Topology topology = options.topology;
+  SudokuStatus status = read_killer_file(filename.c_str(), board, topology);
+  if (status != SUDOKU_OK)
+  {
+    cerr << "Cannot load '" << filename << "': " << sudoku_status_message(status) << ".\n";
+    return 1;
+  }
+
+  TranspositionTable table;
+  if (options.table_megabytes > 0)
+  {
+    status = transposition_create(table, (size_t) options.table_megabytes << 20);
+    if (status != SUDOKU_OK)
+    {
+      cerr << "Cannot create the transposition table: " << sudoku_status_message(status) << ".\n";
+      return 1;
+    }
+  }
+
+  SearchState state;
+  search_init(state, board, topology);
+  const long long count = search_count(state, options.limit,
+                                       options.table_megabytes > 0 ? &table : NULL);
+  cout << count << (options.limit && count == options.limit ? "+" : "") << '\n';
+
+  cerr << "search: " << state.nodes << " placements, " << state.backtracks << " backtracks\n";
+  if (options.table_megabytes > 0)
+  {
+    cerr << "table:  " << table.capacity << " entries, " << table.probes << " probes, "
+         << table.hits << " hits (" << fixed << setprecision(1)
+         << (table.probes ? 100.0 * table.hits / table.probes : 0.0) << "%), " << table.stores
+         << " stores, " << table.replacements << " replacements\n";
+    transposition_destroy(table);
+  }
+  return 0;
+}
+
+/**
+ * Prints the forced and possible digits of every empty cell of a board.
+ */
+static int backbone_command(const string& filename, const Options& options)
+{
+  char board[9][9];
+  Topology topology = options.topology;
+  const SudokuStatus status = read_killer_file(filename.c_str(), board, topology);
+  if (status != SUDOKU_OK)
+  {
+    cerr << "Cannot load '" << filename << "': " << sudoku_status_message(status) << ".\n";
+    return 1;
+  }
+
+  Backbone backbone;
+  if (!analyse_backbone(board, topology, options.threads, backbone))
+  {
+    cerr << "'" << filename << "' has no solution.\n";
+    return 1;
+  }
+
+  // One line per empty cell, named as make_move names cells
+  int empty = 0, possible = 0, legal = 0;
+  for (int cell = 0; cell < 81; cell++)
+  {
+    const int row = cell / 9, column = cell % 9;
+    if (board[row][column] != '.')
+    {
+      continue;
+    }
+    empty++;
+    cout << (char) ('A' + row) << column + 1;
+    for (int d = 0; d < 9; d++)
+    {
+      legal += is_move_valid(row, column, '1' + d, board, topology);
+      if (backbone.candidates[cell][d] == CANDIDATE_FORCED)
+      {
+        cout << " forced " << d + 1;
+      }
+      else if (backbone.candidates[cell][d] == CANDIDATE_POSSIBLE)
+      {
+        cout << ' ' << d + 1;
+        possible++;
+      }
+    }
+    cout << '\n';
+  }
+
+  cerr << "backbone: " << backbone.forced_cells << " of " << empty << " empty cells forced, "
+       << possible << " candidates possible, " << legal - backbone.forced_cells - possible
+       << " of " << legal << " legal moves impossible\n"
+       << "work:     " << backbone.solutions << " solutions reused, " << backbone.probes
+       << " probes (" << backbone.refuted << " refuted), " << backbone.nodes << " placements\n";
+  return 0;
+}
+
+/**
+ * Reduces every corpus puzzle to a minimal puzzle on several threads.
+ */
+static int reduce_command(const string& corpus, const Options& options)
+{
+  vector<string> lines;
+  if (!read_corpus(corpus, lines))
+  {
+    return 1;
+  }
+
+  vector<char> puzzles(lines.size() * 81), minimal(lines.size() * 81);
+  for (size_t i = 0; i < lines.size(); i++)
+  {
+    parse_corpus_line(lines[i], (char (*)[9]) &puzzles[i * 81]);
+  }
+
+  vector<ReduceReport> reports(lines.size());
+  const size_t reduced = reduce_puzzles((const char (*)[9][9]) puzzles.data(), lines.size(),
+                                        options.topology, options.threads,
+                                        (char (*)[9][9]) minimal.data(), reports.data());
+
+  // One line per puzzle: the minimal puzzle and its clue count
+  long long clues_before = 0, clues = 0, forced = 0, searched = 0, probes = 0, nodes = 0;
+  for (size_t i = 0; i < lines.size(); i++)
+  {
+    const ReduceReport& report = reports[i];
+    nodes += report.nodes;
+    if (!report.unique)
+    {
+      cout << lines[i] << (report.solved ? " not-unique\n" : " unsolvable\n");
+      continue;
+    }
+    cout.write(&minimal[i * 81], 81) << ' ' << report.clues << '\n';
+    clues_before += report.clues_before;
+    clues += report.clues;
+    forced += report.forced_removals;
+    searched += report.searched_removals;
+    probes += report.probes;
+  }
+
+  cerr << "reduced " << reduced << " of " << lines.size() << " puzzles from " << clues_before
+       << " to " << clues << " clues: " << forced << " removals forced by singles, " << searched
+       << " proved by search (" << probes << " probes, " << nodes << " placements)\n";
+  return 0;
+}
+
+/**
+ * Solves every corpus puzzle missing from a solution database and appends it. A new database
+ * is created for the variant's units, and an existing one must have been built for them.
+ */
+static int db_build_command(const string& database, const string& corpus, const Options& options)
+{
+  CorpusReader reader;
+  if (!open_corpus(corpus, reader))
+  {
+    return 1;
+  }
+  SolutionDb db;
+  if (!open_database(database, options, db))
+  {
+    corpus_close(reader);
+    return 1;
+  }
+
+  // The corpus is streamed, so a build never holds more than one puzzle in memory
+  SudokuStatus status = SUDOKU_OK;
+  unsigned long long index = 0, added = 0, present = 0;
+  string line;
+  while (status == SUDOKU_OK && corpus_read_line(reader, line))
+  {
+    char board[9][9];
+    if (!parse_corpus_line(line, board))
+    {
+      continue;
+    }
+    index++;
+    bool stored;
+    status = store_record(db, board, options.topology, stored);
+    if (status != SUDOKU_OK)
+    {
+      cerr << "Cannot add puzzle #" << index << ": " << sudoku_status_message(status) << ".\n";
+      break;
+    }
+    added += stored;
+    present += !stored;
+  }
+  const bool read = close_corpus(corpus, reader);
+
+  cout << added << " added, " << present << " already present, " << solution_db_count(db)
+       << " records in '" << database << "'\n";
+  solution_db_close(db);
+  return status == SUDOKU_OK && read ? 0 : 1;
+}
+
+/**
+ * Looks up every corpus puzzle in a solution database built for the variant's units,
+ * printing what is stored.
+ */
+static int db_lookup_command(const string& database, const string& corpus, const Options& options)
+{
+  vector<string> puzzles;
+  if (!read_corpus(corpus, puzzles))
+  {
+    return 1;
+  }
+
+  SolutionDb db;
+  const SudokuStatus status = solution_db_open(database.c_str(), false, options.topology, db);
+  if (status != SUDOKU_OK)
+  {
+    cerr << "Cannot open '" << database << "': " << sudoku_status_message(status) << ".\n";
+    return 1;
+  }
+
+  int hits = 0;
+  for (size_t i = 0; i < puzzles.size(); i++)
+  {
+    char board[9][9];
+    parse_corpus_line(puzzles[i], board);
+
+    SolutionRecord record;
+    if (!solution_db_lookup(db, board, record))
+    {
+      cout << "#" << i + 1 << " not found\n";
+      continue;
+    }
+    hits++;
+    cout << "#" << i + 1 << ' ';
+    if (record.solved)
+    {
+      cout.write(&record.solution[0][0], 81);
+    }
+    else
+    {
+      cout << "unsolvable";
+    }
+    cout << " solutions=" << record.solution_count << (record.solution_count > 1 ? "+" : "")
+         << " backtracks=" << record.backtracks << " difficulty=" << record.difficulty << '\n';
+  }
+
+  cerr << hits << " of " << puzzles.size() << " puzzles found\n";
+  solution_db_close(db);
+  return 0;
+}
+
+// The ring shm-serve is answering, so an interrupt can stop it cleanly
+static ShmRing* serving_ring = NULL;
+
+/**
+ * Stops the ring being served when the program is interrupted, so the solver threads return
+ * and the segment is removed.
+ */
+static void stop_serving(int)
+{
+  if (serving_ring)
+  {
+    shm_ring_stop(*serving_ring);
+  }
+}
+
+/**
+ * Creates a shared-memory solver ring and answers its requests until it is stopped.
+ */
+static int shm_serve_command(const string& name, const Options& options)
+{
+  ShmRing ring;
+  const SudokuStatus status = shm_ring_create(name.c_str(), options.capacity, ring);
+  if (status != SUDOKU_OK)
+  {
+    cerr << "Cannot create ring '" << name << "': " << sudoku_status_message(status) << ".\n";
+    return 1;
+  }
+  cerr << "serving ring " << ring.name << " (" << ring.capacity << " slots) on "
+       << options.threads << " thread(s); stop it with: sudoku shm-stop " << name << '\n';
+
+  serving_ring = &ring;
+  void (*previous_interrupt)(int) = signal(SIGINT, stop_serving);
+  void (*previous_terminate)(int) = signal(SIGTERM, stop_serving);
+  const unsigned long long answered = shm_ring_serve(ring, options.topology, options.threads);
+  signal(SIGINT, previous_interrupt);
+  signal(SIGTERM, previous_terminate);
+  serving_ring = NULL;
+
+  cerr << "answered " << answered << " boards\n";
+  shm_ring_close(ring);
+  return 0;
+}
+
+/**
+ * Solves every corpus puzzle through a shared-memory solver ring, one board at a time,
+ * printing the solutions and the round-trip latency.
+ */
+static int shm_solve_command(const string& name, const string& corpus, const Options& options)
+{
+  vector<string> puzzles;
+  if (!read_corpus(corpus, puzzles))
+  {
+    return 1;
+  }
+  if (options.limit > 0 && puzzles.size() > (size_t) options.limit)
+  {
+    puzzles.resize(options.limit);
+  }
+
+  ShmRing ring;
+  SudokuStatus status = shm_ring_attach(name.c_str(), ring);
+  if (status != SUDOKU_OK)
+  {
+    cerr << "Cannot attach to ring '" << name << "': " << sudoku_status_message(status) << ".\n";
+    return 1;
+  }
+
+  // Each board waits for its reply before the next is sent, so every round trip is timed on
+  // its own; the solver's own time is subtracted to leave the cost of the ring
+  vector<long long> round_trips, overheads;
+  const long long start = now_ns();
+  for (size_t i = 0; i < puzzles.size(); i++)
+  {
+    char board[9][9];
+    parse_corpus_line(puzzles[i], board);
+
+    ShmReply reply;
+    const long long sent = now_ns();
+    status = shm_ring_solve(ring, board, reply);
+    const long long received = now_ns();
+    if (status != SUDOKU_OK)
+    {
+      cerr << "Cannot solve puzzle #" << i + 1 << ": " << sudoku_status_message(status) << ".\n";
+      break;
+    }
+    round_trips.push_back(received - sent);
+    overheads.push_back(received - sent - reply.solve_ns);
+
+    if (reply.solved)
+    {
+      cout.write(&reply.board[0][0], 81) << '\n';
+    }
+    else
+    {
+      cout << "unsolvable\n";
+    }
+  }
+  const double seconds = (now_ns() - start) / 1e9;
+  shm_ring_close(ring);
+
+  const size_t answered = round_trips.size();
+  cerr << "ring " << ring.name << ": " << answered << " boards in " << fixed << setprecision(3)
+       << seconds << " s\n" << setprecision(2)
+       << "round trip:    median " << percentile(round_trips, 0.5) / 1e3 << " us, p99 "
+       << percentile(round_trips, 0.99) / 1e3 << " us\n"
+       << "ring overhead: median " << percentile(overheads, 0.5) / 1e3 << " us, p99 "
+       << percentile(overheads, 0.99) / 1e3 << " us (round trip minus solve time)\n";
+  return status == SUDOKU_OK ? 0 : 1;
+}
+
+/**
+ * Stops the solver of a shared-memory ring and removes the ring's segment.
+ */
+static int shm_stop_command(const string& name)
+{
+  ShmRing ring;
+  const SudokuStatus status = shm_ring_attach(name.c_str(), ring);
+  if (status == SUDOKU_OK)
+  {
+    shm_ring_stop(ring);
+    shm_ring_close(ring);
+  }
+  else if (status != SUDOKU_ERROR_RING_STOPPED)
+  {
+    cerr << "Cannot attach to ring '" << name << "': " << sudoku_status_message(status) << ".\n";
+    return 1;
+  }
+  shm_ring_remove(name.c_str());
+  return 0;
+}
+
+/**
+ * Prints the usage message for the command-line modes.
+ */
+static int usage()
+{
+  cerr << "Usage: sudoku                                 run the coursework demonstration\n"
+       << "       sudoku bench [--perf] <board.dat>...   time each board with every engine\n"
+       << "       sudoku batch [--perf] [--output FILE] [--write-thread] [--db FILE] <corpus>\n"
+       << "                                              solve every puzzle in a corpus\n"
+       << "       (corpora may be gzip or zstd compressed, and output files ending in .gz or\n"
+       << "       .zst are compressed the same way; FILE may end in .dat, .csv or .jsonl too)\n"
+       << "       sudoku enumerate [--limit N] [--threads T] <board.dat>\n"
+       << "                                              stream the solutions of a board\n"
+       << "       sudoku enumerate [--limit N] --checkpoint FILE [--interval N] <board.dat>\n"
+       << "                                              the same, saving/resuming checkpoints\n"
+       << "       sudoku shard [--prefix K] [--workers W] [--limit N] <board.dat>\n"
+       << "                                              search in W processes, K decisions per shard\n"
+       << "       (bench, batch, enumerate and shard accept --regions FILE for a jigsaw region\n"
+       << "       map and --diagonals for the two main diagonals, and board files may end with\n"
+       << "       killer cages, one per line: cage <sum> <cell> <cell> ..., e.g. cage 15 A1 A2 B1)\n"
+       << "       sudoku resolve <previous-solution.dat> <edited.dat>\n"
+       << "                                              re-solve an edited board from its old solution\n"
+       << "       sudoku count [--limit N] [--table MB] <board.dat>\n"
+       << "                                              count the solutions of a board\n"
+       << "       sudoku backbone [--threads T] <board.dat>\n"
+       << "                                              list the forced and possible digits of each cell\n"
+       << "       sudoku reduce [--threads T] <corpus>   reduce each puzzle to a minimal one\n"
+       << "       sudoku db-build [--capacity N] <database> <corpus>\n"
+       << "                                              add solved corpus puzzles to a database\n"
+       << "       sudoku db-lookup <database> <corpus>   look corpus puzzles up in a database\n"
+       << "       sudoku shm-serve [--threads T] [--capacity N] <ring>\n"
+       << "                                              solve boards sent through shared memory\n"
+       << "       sudoku shm-solve [--limit N] <ring> <corpus>\n"
+       << "                                              solve a corpus through a ring, timing it\n"
+       << "       sudoku shm-stop <ring>                 stop a ring's solver and remove the ring\n";
+  return 2;
+}
+
+/**
+ * Runs one of the command-line modes of the sudoku program.
+ *
+ * @param argc - the argument count passed to main.
+ * @param argv - the arguments passed to main; argv[1] is the mode.
+ *
+ * @return the exit status for the program (0 on success).
+ */
+int run_command(int argc, char* argv[])
+{
+  const string mode = argv[1];
+  Options options;
+  options.perf = false;
+  options.limit = 0;
+  options.threads = 1;
+  options.interval = 10000000;
+  options.prefix = 4;
+  options.workers = 4;
+  options.capacity = 1 << 16;
+  options.write_thread = false;
+  options.table_megabytes = 64;
+  string regions;
+  bool diagonals = false;
+  vector<string>& arguments = options.arguments;
+
+  for (int i = 2; i < argc; i++)
+  {
+    if (!strcmp(argv[i], "--perf"))
+    {
+      options.perf = true;
+    }
+    else if (!strcmp(argv[i], "--limit") && i + 1 < argc)
+    {
+      options.limit = atoll(argv[++i]);
+    }
+    else if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+    {
+      options.threads = atoi(argv[++i]);
+    }
+    else if (!strcmp(argv[i], "--checkpoint") && i + 1 < argc)
+    {
+      options.checkpoint = argv[++i];
+    }
+    else if (!strcmp(argv[i], "--interval") && i + 1 < argc)
+    {
+      options.interval = atoll(argv[++i]);
+    }
+    else if (!strcmp(argv[i], "--prefix") && i + 1 < argc)
+    {
+      options.prefix = atoi(argv[++i]);
+    }
+    else if (!strcmp(argv[i], "--workers") && i + 1 < argc)
+    {
+      options.workers = atoi(argv[++i]);
+    }
+    else if (!strcmp(argv[i], "--capacity") && i + 1 < argc)
+    {
+      options.capacity = strtoull(argv[++i], NULL, 10);
+    }
+    else if (!strcmp(argv[i], "--table") && i + 1 < argc)
+    {
+      options.table_megabytes = atoll(argv[++i]);
+    }
+    else if (!strcmp(argv[i], "--output") && i + 1 < argc)
+    {
+      options.output = argv[++i];
+    }
+    else if (!strcmp(argv[i], "--write-thread"))
+    {
+      options.write_thread = true;
+    }
+    else if (!strcmp(argv[i], "--db") && i + 1 < argc)
+    {
+      options.database = argv[++i];
+    }
+    else if (!strcmp(argv[i], "--regions") && i + 1 < argc)
+    {
+      regions = argv[++i];
+    }
+    else if (!strcmp(argv[i], "--diagonals"))
+    {
+      diagonals = true;
+    }
+    else
+    {
+      arguments.push_back(argv[i]);
+    }
+  }
+
+  // Compile the variant's units once, before any search uses them
+  const SudokuStatus built = regions.empty() ? build_topology(NULL, diagonals, options.topology) :
+                             read_topology_file(regions.c_str(), diagonals, options.topology);
+  if (built != SUDOKU_OK)
+  {
+    cerr << "Cannot load region map '" << regions << "': " << sudoku_status_message(built) << ".\n";
+    return 1;
+  }
+
+  if (mode == "bench" && !arguments.empty())
+  {
+    return bench_command(arguments, options);
+  }
+  if (mode == "batch" && arguments.size() == 1)
+  {
+    return batch_command(arguments[0], options);
+  }
+  if (mode == "enumerate" && arguments.size() == 1)
+  {
+    return enumerate_command(arguments[0], options);
+  }
+  if (mode == "shard" && arguments.size() == 1)
+  {
+    return shard_command(arguments[0], options);
+  }
+  if (mode == "resolve" && arguments.size() == 2)
+  {
+    return resolve_command(arguments[0], arguments[1], options);
+  }
+  if (mode == "count" && arguments.size() == 1)
+  {
+    return count_command(arguments[0], options);
+  }
+  if (mode == "backbone" && arguments.size() == 1)
+  {
+    return backbone_command(arguments[0], options);
+  }
+  if (mode == "reduce" && arguments.size() == 1)
+  {
+    return reduce_command(arguments[0], options);
+  }
+  if (mode == "db-build" && arguments.size() == 2)
+  {
+    return db_build_command(arguments[0], arguments[1], options);
+  }
+  if (mode == "db-lookup" && arguments.size() == 2)
+  {
+    return db_lookup_command(arguments[0], arguments[1], options);
+  }
+  if (mode == "shm-serve" && arguments.size() == 1)
+  {
+    return shm_serve_command(arguments[0], options);
+  }
+  if (mode == "shm-solve" && arguments.size() == 2)
+  {
+    return shm_solve_command(arguments[0], arguments[1], options);
+  }
+  if (mode == "shm-stop" && arguments.size() == 1)
+  {
+    return shm_stop_command(arguments[0]);
+  }
+  return usage();
+}
@@ -0,0 +1,84 @@
+#ifndef CLI_H
+#define CLI_H
+
+/* COMMAND-LINE MODES */
+
+/**
+ * Runs one of the command-line modes of the sudoku program.
+ *
+ * The first argument names the mode:
+ *      - bench [--perf] <board.dat>...
+ *        Solves each board file with every engine and reports the time taken
+ *        (and hardware counters with --perf) per engine and per board.
+ *      - batch [--perf] [--output FILE] [--write-thread] [--db FILE] <corpus>
+ *        Solves every puzzle in a corpus file (one 81-character puzzle per line,
+ *        with '.' or '0' for empty cells) with every engine, reporting each
+ *        puzzle and the totals per engine. With --output the solutions go to FILE
+ *        (one line each, or .dat boards if FILE ends in .dat), or, if FILE ends in
+ *        .csv or .jsonl, every engine's time and counters for every puzzle. The
+ *        file is written in large blocks, on a thread of its own with --write-thread.
+ *        With --db, each puzzle not yet in the solution database FILE is solved and
+ *        appended to it as the corpus is streamed (see db-build).
+ *      Every mode that reads a corpus streams it, decompressing gzip and zstd files
+ *      (recognised by their first bytes) on a separate thread; output file names
+ *      ending in .gz or .zst are compressed the same way.
+ *      - enumerate [--limit N] [--threads T] <board.dat>
+ *        Streams every solution of a board (or the first N) as 81-character lines,
+ *        searching on T threads if asked to. With --checkpoint FILE the search state
+ *        is saved every --interval placements and at the end, each printed solution
+ *        is counted in FILE.delivered, and a later run with the same file resumes
+ *        after the last solution printed, so none is printed twice or skipped.
+ *      - shard [--prefix K] [--workers W] [--limit N] <board.dat>
+ *        Splits the search into shards by its first K decisions, searches them in W
+ *        forked worker processes, and prints the merged counts (and the first N
+ *        solutions) with a shard-balance report.
+ *      Bench, batch, enumerate and shard solve a variant instead of classic sudoku if
+ *      given --regions FILE (a jigsaw region map, nine labels per line) and/or
+ *      --diagonals, and their board files may end with killer cages ("cage 15 A1 A2
+ *      B1" lines).
+ *      - resolve <previous-solution.dat> <edited.dat>
+ *        Re-solves an edited board starting from the solution it had before the edit,
+ *        and reports how much of the board had to be searched again next to the work
+ *        of a cold solve. Accepts the same variant options as enumerate.
+ *      - count [--limit N] [--table MB] <board.dat>
+ *        Counts the solutions of a board (up to N), caching the counts of subtrees in
+ *        a transposition table of MB megabytes (64 by default, 0 for none) so that a
+ *        subtree reached again is not searched again, and reports the table's hit rate.
+ *        Accepts the same variant options as enumerate.
+ *      - backbone [--threads T] <board.dat>
+ *        Prints each empty cell with the digit every solution puts there ("forced") or
+ *        the digits some solution puts there, probing candidates on T threads. Accepts
+ *        the same variant options as enumerate.
+ *      - reduce [--threads T] <corpus>
+ *        Removes clues from every corpus puzzle until removing any more would lose
+ *        its unique solution, reducing the puzzles on T threads, and prints each
+ *        minimal puzzle with its clue count; a puzzle that cannot be reduced is
+ *        printed as given, marked "unsolvable" or "not-unique". Accepts --regions
+ *        and --diagonals.
+ *      - db-build [--capacity N] <database> <corpus>
+ *        Streams the corpus, solving every puzzle that is not yet in the solution
+ *        database (creating it with N slots if needed) and appending the results.
+ *      - db-lookup <database> <corpus>
+ *        Looks every corpus puzzle up in the database through its memory mapping.
+ *        Both accept --regions and --diagonals; a database only holds the puzzles
+ *        of the variant it was created for, and refuses to open for any other.
+ *      - shm-serve [--threads T] [--capacity N] <ring>
+ *        Creates a shared-memory ring of N slots (a POSIX shared-memory segment) and
+ *        answers the boards other processes put into it on T threads, until the ring
+ *        is stopped or the program is interrupted. Accepts --regions and --diagonals.
+ *      - shm-solve [--limit N] <ring> <corpus>
+ *        Sends every corpus puzzle (or the first N) through a ring one at a time,
+ *        printing the solutions and the round-trip latency with and without the
+ *        solve time.
+ *      - shm-stop <ring>
+ *        Stops the solver of a ring and removes the ring, even one left behind by a
+ *        solver that crashed.
+ *
+ * @param argc - the argument count passed to main.
+ * @param argv - the arguments passed to main; argv[1] is the mode.
+ *
+ * @return the exit status for the program (0 on success).
+ */
+int run_command(int argc, char* argv[]);
+
+#endif
@@ -0,0 +1,741 @@
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <zlib.h>
+#ifdef SUDOKU_ZSTD
+#include <zstd.h>
+#endif
+#include "corpus_io.h"
+
+using namespace std;
+
+/* INTERNAL HELPERS */
+
+// The size of each block read from a file, and of each decompressed chunk
+static const size_t BLOCK_SIZE = 1 << 18;
+
+// How many decompressed chunks the thread may get ahead of the reader
+static const size_t MAX_QUEUED_CHUNKS = 4;
+
+/**
+ * The decompression thread of a reader and the chunks it has decoded.
+ *
+ * The thread owns the file and the decompressor; the queue, the flags and the counters are
+ * shared with the reader under the lock. The current chunk belongs to the reader alone.
+ */
+struct CorpusPipe
+{
+  FILE* file;
+  Compression compression;
+  string first_block;
+  thread worker;
+
+  mutex lock;
+  condition_variable changed;
+  deque<string> chunks;
+  bool done;
+  bool stop;
+  SudokuStatus status;
+  unsigned long long file_bytes;
+
+  string current;
+  size_t position;
+};
+
+/**
+ * Hands a decoded chunk to the reader, waiting while the queue is full.
+ *
+ * @param pipe - the pipe of the reader.
+ * @param chunk - the chunk, which is moved into the queue and left empty.
+ * @param file_bytes - the number of bytes read from the file so far.
+ *
+ * @return true - if the chunk was queued, otherwise false if the reader is closing.
+ */
+static bool push_chunk(CorpusPipe& pipe, string& chunk, unsigned long long file_bytes)
+{
+  unique_lock<mutex> guard(pipe.lock);
+  pipe.changed.wait(guard, [&] { return pipe.stop || pipe.chunks.size() < MAX_QUEUED_CHUNKS; });
+  if (pipe.stop)
+  {
+    return false;
+  }
+  pipe.file_bytes = file_bytes;
+  pipe.chunks.push_back(move(chunk));
+  chunk.clear();
+  pipe.changed.notify_all();
+  return true;
+}
+
+/**
+ * Reads the next block of a file, starting with the block read when it was opened.
+ *
+ * @param pipe - the pipe of the reader.
+ * @param block - set to the bytes read; empty at the end of the file.
+ *
+ * @return true - unless the file could not be read.
+ */
+static bool read_block(CorpusPipe& pipe, string& block)
+{
+  if (!pipe.first_block.empty())
+  {
+    block.swap(pipe.first_block);
+    pipe.first_block.clear();
+    return true;
+  }
+  block.resize(BLOCK_SIZE);
+  block.resize(fread(&block[0], 1, BLOCK_SIZE, pipe.file));
+  return !ferror(pipe.file);
+}
+
+/**
+ * Copies a plain file into chunks.
+ *
+ * @param pipe - the pipe of the reader.
+ *
+ * @return SUDOKU_OK, or the code describing why reading stopped.
+ */
+static SudokuStatus copy_plain(CorpusPipe& pipe)
+{
+  string block;
+  unsigned long long file_bytes = 0;
+  while (true)
+  {
+    if (!read_block(pipe, block))
+    {
+      return SUDOKU_ERROR_OPEN_FAILED;
+    }
+    if (block.empty())
+    {
+      return SUDOKU_OK;
+    }
+    file_bytes += block.size();
+    if (!push_chunk(pipe, block, file_bytes))
+    {
+      return SUDOKU_OK;
+    }
+  }
+}
+
+/**
+ * Inflates a gzip file into chunks, one member after another.
+ *
+ * @param pipe - the pipe of the reader.
+ *
+ * @return SUDOKU_OK, or the code describing why reading stopped.
+ */
+static SudokuStatus inflate_gzip(CorpusPipe& pipe)
+{
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  if (inflateInit2(&stream, 15 + 16) != Z_OK)
+  {
+    return SUDOKU_ERROR_WORKER_FAILED;
+  }
+
+  string block, chunk;
+  unsigned long long file_bytes = 0;
+  bool in_member = false;
+  SudokuStatus status = SUDOKU_OK;
+  while (status == SUDOKU_OK)
+  {
+    if (!read_block(pipe, block))
+    {
+      status = SUDOKU_ERROR_OPEN_FAILED;
+      break;
+    }
+    if (block.empty())
+    {
+      // The file must not end part-way through a member
+      if (in_member)
+      {
+        status = SUDOKU_ERROR_CORRUPT_STREAM;
+      }
+      break;
+    }
+    file_bytes += block.size();
+    stream.next_in = (Bytef*) &block[0];
+    stream.avail_in = block.size();
+
+    // A full chunk may mean the inflater holds more output, even with no input left
+    while ((stream.avail_in > 0 || chunk.size() == BLOCK_SIZE) && status == SUDOKU_OK)
+    {
+      if (chunk.size() == BLOCK_SIZE && !push_chunk(pipe, chunk, file_bytes))
+      {
+        inflateEnd(&stream);
+        return SUDOKU_OK;
+      }
+      const size_t used = chunk.size();
+      chunk.resize(BLOCK_SIZE);
+      stream.next_out = (Bytef*) &chunk[used];
+      stream.avail_out = BLOCK_SIZE - used;
+      in_member = in_member || stream.avail_in > 0;
+      const int result = inflate(&stream, Z_NO_FLUSH);
+      chunk.resize(BLOCK_SIZE - stream.avail_out);
+      if (result == Z_STREAM_END)
+      {
+        // Another member may follow, as written by "cat a.gz b.gz"
+        in_member = false;
+        inflateReset(&stream);
+      }
+      else if (result != Z_OK && result != Z_BUF_ERROR)
+      {
+        status = SUDOKU_ERROR_CORRUPT_STREAM;
+      }
+    }
+  }
+  inflateEnd(&stream);
+
+  if (!chunk.empty() && !push_chunk(pipe, chunk, file_bytes))
+  {
+    return SUDOKU_OK;
+  }
+  return status;
+}
+
+#ifdef SUDOKU_ZSTD
+/**
+ * Decompresses a zstd file into chunks, one frame after another.
+ *
+ * @param pipe - the pipe of the reader.
+ *
+ * @return SUDOKU_OK, or the code describing why reading stopped.
+ */
+static SudokuStatus decompress_zstd(CorpusPipe& pipe)
+{
+  ZSTD_DCtx* context = ZSTD_createDCtx();
+  if (!context)
+  {
+    return SUDOKU_ERROR_WORKER_FAILED;
+  }
+
+  string block, chunk;
+  unsigned long long file_bytes = 0;
+  size_t pending = 0;
+  SudokuStatus status = SUDOKU_OK;
+  while (status == SUDOKU_OK)
+  {
+    if (!read_block(pipe, block))
+    {
+      status = SUDOKU_ERROR_OPEN_FAILED;
+      break;
+    }
+    if (block.empty())
+    {
+      // A non-zero hint means the last frame was cut short
+      if (pending != 0)
+      {
+        status = SUDOKU_ERROR_CORRUPT_STREAM;
+      }
+      break;
+    }
+    file_bytes += block.size();
+    ZSTD_inBuffer input = { block.data(), block.size(), 0 };
+
+    // A full chunk may mean the decompressor holds more output, even with no input left
+    while ((input.pos < input.size || chunk.size() == BLOCK_SIZE) && status == SUDOKU_OK)
+    {
+      if (chunk.size() == BLOCK_SIZE && !push_chunk(pipe, chunk, file_bytes))
+      {
+        ZSTD_freeDCtx(context);
+        return SUDOKU_OK;
+      }
+      const size_t used = chunk.size();
+      chunk.resize(BLOCK_SIZE);
+      ZSTD_outBuffer output = { &chunk[0], BLOCK_SIZE, used };
+      const size_t consumed = input.pos;
+      const size_t hint = ZSTD_decompressStream(context, &output, &input);
+      chunk.resize(output.pos);
+      if (ZSTD_isError(hint))
+      {
+        status = SUDOKU_ERROR_CORRUPT_STREAM;
+      }
+      else if (output.pos > used || input.pos > consumed)
+      {
+        pending = hint;
+      }
+    }
+  }
+  ZSTD_freeDCtx(context);
+
+  if (!chunk.empty() && !push_chunk(pipe, chunk, file_bytes))
+  {
+    return SUDOKU_OK;
+  }
+  return status;
+}
+#endif
+
+/**
+ * The body of the decompression thread: decodes the whole file, then marks the pipe done.
+ *
+ * @param pipe - the pipe of the reader.
+ */
+static void decode_corpus(CorpusPipe* pipe)
+{
+  SudokuStatus status = SUDOKU_OK;
+  switch (pipe->compression)
+  {
+    case COMPRESSION_NONE:
+      status = copy_plain(*pipe);
+      break;
+    case COMPRESSION_GZIP:
+      status = inflate_gzip(*pipe);
+      break;
+    case COMPRESSION_ZSTD:
+#ifdef SUDOKU_ZSTD
+      status = decompress_zstd(*pipe);
+#else
+      status = SUDOKU_ERROR_UNSUPPORTED_FORMAT;
+#endif
+      break;
+  }
+
+  lock_guard<mutex> guard(pipe->lock);
+  pipe->done = true;
+  pipe->status = status;
+  pipe->changed.notify_all();
+}
+
+/**
+ * The compressor of a writer and the data waiting to be compressed.
+ */
+struct CorpusEncoder
+{
+  FILE* file;
+  string pending;
+  z_stream gzip;
+#ifdef SUDOKU_ZSTD
+  ZSTD_CCtx* zstd;
+#endif
+};
+
+/**
+ * Compresses data for a writer and writes it out.
+ *
+ * @param writer - the writer.
+ * @param data - the bytes to compress (the caller's buffer or the writer's pending data).
+ * @param length - the number of bytes.
+ * @param finish - whether to end the compressed stream as well.
+ *
+ * @return true - if everything was written, otherwise false.
+ */
+static bool encode(CorpusWriter& writer, const char* data, size_t length, bool finish)
+{
+  CorpusEncoder& encoder = *writer.encoder;
+  if (writer.compression == COMPRESSION_NONE)
+  {
+    writer.file_bytes += length;
+    return length == 0 || fwrite(data, 1, length, encoder.file) == length;
+  }
+
+  string output;
+  bool ok = true;
+  if (writer.compression == COMPRESSION_GZIP)
+  {
+    encoder.gzip.next_in = (Bytef*) data;
+    encoder.gzip.avail_in = length;
+    int result;
+    do
+    {
+      const size_t used = output.size();
+      output.resize(used + BLOCK_SIZE);
+      encoder.gzip.next_out = (Bytef*) &output[used];
+      encoder.gzip.avail_out = BLOCK_SIZE;
+      result = deflate(&encoder.gzip, finish ? Z_FINISH : Z_NO_FLUSH);
+      output.resize(used + BLOCK_SIZE - encoder.gzip.avail_out);
+    } while (finish ? result == Z_OK : encoder.gzip.avail_in > 0);
+    ok = finish ? result == Z_STREAM_END : result != Z_STREAM_ERROR;
+  }
+#ifdef SUDOKU_ZSTD
+  else
+  {
+    ZSTD_inBuffer input = { data, length, 0 };
+    size_t remaining;
+    do
+    {
+      const size_t used = output.size();
+      output.resize(used + BLOCK_SIZE);
+      ZSTD_outBuffer out = { &output[0], used + BLOCK_SIZE, used };
+      remaining = ZSTD_compressStream2(encoder.zstd, &out, &input,
+                                       finish ? ZSTD_e_end : ZSTD_e_continue);
+      output.resize(out.pos);
+    } while (!ZSTD_isError(remaining) && (finish ? remaining != 0 : input.pos < input.size));
+    ok = !ZSTD_isError(remaining);
+  }
+#endif
+
+  if (!output.empty() && fwrite(output.data(), 1, output.size(), encoder.file) != output.size())
+  {
+    ok = false;
+  }
+  writer.file_bytes += output.size();
+  return ok;
+}
+
+/**
+ * Compresses the pending data of a writer and writes it out.
+ *
+ * @param writer - the writer.
+ * @param finish - whether to end the compressed stream as well.
+ *
+ * @return true - if everything was written, otherwise false.
+ */
+static bool flush_pending(CorpusWriter& writer, bool finish)
+{
+  CorpusEncoder& encoder = *writer.encoder;
+  const bool ok = encode(writer, encoder.pending.data(), encoder.pending.size(), finish);
+  encoder.pending.clear();
+  return ok;
+}
+
+/* COMPRESSED CORPUS STREAMS */
+
+/**
+ * Returns the compression a file name asks for: ".gz" for gzip, ".zst" for zstd.
+ *
+ * @param filename - a constant character pointer to the file path.
+ *
+ * @return the compression matching the file's extension, or COMPRESSION_NONE.
+ */
+Compression compression_for_name(const char* filename)
+{
+  if (!filename)
+  {
+    return COMPRESSION_NONE;
+  }
+  const size_t length = strlen(filename);
+  if (length > 3 && !strcmp(filename + length - 3, ".gz"))
+  {
+    return COMPRESSION_GZIP;
+  }
+  if (length > 4 && !strcmp(filename + length - 4, ".zst"))
+  {
+    return COMPRESSION_ZSTD;
+  }
+  return COMPRESSION_NONE;
+}
+
+/**
+ * Returns a short name for a compression format.
+ *
+ * @param compression - the format to name.
+ *
+ * @return a constant C-string naming the format.
+ */
+const char* compression_name(Compression compression)
+{
+  switch (compression)
+  {
+    case COMPRESSION_NONE:
+      return "none";
+    case COMPRESSION_GZIP:
+      return "gzip";
+    case COMPRESSION_ZSTD:
+      return "zstd";
+  }
+  return "unknown";
+}
+
+/**
+ * Opens a corpus file for streaming, decompressing it on a thread of its own.
+ *
+ * @param filename - a constant character pointer to the corpus-file path.
+ * @param reader - the reader to open.
+ *
+ * @return SUDOKU_OK - if the file was opened, otherwise the code describing the failure.
+ */
+SudokuStatus corpus_open(const char* filename, CorpusReader& reader)
+{
+  reader.pipe = NULL;
+  reader.compression = COMPRESSION_NONE;
+  reader.status = SUDOKU_OK;
+  reader.file_bytes = 0;
+  reader.data_bytes = 0;
+  if (!filename)
+  {
+    return SUDOKU_ERROR_INVALID_ARGUMENT;
+  }
+
+  FILE* file = fopen(filename, "rb");
+  if (!file)
+  {
+    return SUDOKU_ERROR_OPEN_FAILED;
+  }
+
+  // Read the first block here, so the format is known before the thread starts
+  CorpusPipe* pipe = new CorpusPipe();
+  pipe->file = file;
+  pipe->first_block.resize(BLOCK_SIZE);
+  pipe->first_block.resize(fread(&pipe->first_block[0], 1, BLOCK_SIZE, file));
+  const unsigned char* magic = (const unsigned char*) pipe->first_block.data();
+  const size_t size = pipe->first_block.size();
+  if (size >= 2 && magic[0] == 0x1F && magic[1] == 0x8B)
+  {
+    pipe->compression = COMPRESSION_GZIP;
+  }
+  else if (size >= 4 && magic[0] == 0x28 && magic[1] == 0xB5 && magic[2] == 0x2F && magic[3] == 0xFD)
+  {
+    pipe->compression = COMPRESSION_ZSTD;
+  }
+  else
+  {
+    pipe->compression = COMPRESSION_NONE;
+  }
+#ifndef SUDOKU_ZSTD
+  if (pipe->compression == COMPRESSION_ZSTD)
+  {
+    fclose(file);
+    delete pipe;
+    return SUDOKU_ERROR_UNSUPPORTED_FORMAT;
+  }
+#endif
+
+  pipe->done = false;
+  pipe->stop = false;
+  pipe->status = SUDOKU_OK;
+  pipe->file_bytes = 0;
+  pipe->position = 0;
+  try
+  {
+    pipe->worker = thread(decode_corpus, pipe);
+  }
+  catch (...)
+  {
+    fclose(file);
+    delete pipe;
+    return SUDOKU_ERROR_WORKER_FAILED;
+  }
+
+  reader.pipe = pipe;
+  reader.compression = pipe->compression;
+  return SUDOKU_OK;
+}
+
+/**
+ * Reads the next line of a corpus.
+ *
+ * @param reader - an open reader.
+ * @param line - set to the line, without its "\n" or "\r\n".
+ *
+ * @return true - if a line was read, otherwise false.
+ */
+bool corpus_read_line(CorpusReader& reader, string& line)
+{
+  line.clear();
+  CorpusPipe* pipe = reader.pipe;
+  if (!pipe)
+  {
+    return false;
+  }
+
+  while (true)
+  {
+    // Take the line from the current chunk if its end is there
+    const char* start = pipe->current.data() + pipe->position;
+    const size_t available = pipe->current.size() - pipe->position;
+    const char* end = (const char*) memchr(start, '\n', available);
+    if (end)
+    {
+      line.append(start, end - start);
+      pipe->position += end - start + 1;
+      if (!line.empty() && line[line.size() - 1] == '\r')
+      {
+        line.erase(line.size() - 1);
+      }
+      return true;
+    }
+    line.append(start, available);
+    pipe->position = pipe->current.size();
+
+    // Otherwise wait for the next chunk
+    unique_lock<mutex> guard(pipe->lock);
+    pipe->changed.wait(guard, [&] { return pipe->done || !pipe->chunks.empty(); });
+    if (pipe->chunks.empty())
+    {
+      reader.status = pipe->status;
+      reader.file_bytes = pipe->file_bytes;
+      if (line.empty() || reader.status != SUDOKU_OK)
+      {
+        return false;
+      }
+      // The last line need not end in a newline
+      if (line[line.size() - 1] == '\r')
+      {
+        line.erase(line.size() - 1);
+      }
+      return true;
+    }
+    pipe->current.swap(pipe->chunks.front());
+    pipe->chunks.pop_front();
+    pipe->position = 0;
+    reader.file_bytes = pipe->file_bytes;
+    reader.data_bytes += pipe->current.size();
+    pipe->changed.notify_all();
+  }
+}
+
+/**
+ * Stops the decompression thread and closes a corpus file.
+ *
+ * @param reader - the reader to close.
+ */
+void corpus_close(CorpusReader& reader)
+{
+  CorpusPipe* pipe = reader.pipe;
+  if (!pipe)
+  {
+    return;
+  }
+  {
+    lock_guard<mutex> guard(pipe->lock);
+    pipe->stop = true;
+    pipe->changed.notify_all();
+  }
+  pipe->worker.join();
+  fclose(pipe->file);
+  delete pipe;
+  reader.pipe = NULL;
+}
+
+/**
+ * Creates a file to write a corpus or results to, compressed as its name asks.
+ *
+ * @param filename - a constant character pointer to the output path.
+ * @param writer - the writer to open.
+ *
+ * @return SUDOKU_OK - if the file was created, otherwise the code describing the failure.
+ */
+SudokuStatus corpus_create(const char* filename, CorpusWriter& writer)
+{
+  writer.encoder = NULL;
+  writer.compression = compression_for_name(filename);
+  writer.file_bytes = 0;
+  writer.data_bytes = 0;
+  if (!filename)
+  {
+    return SUDOKU_ERROR_INVALID_ARGUMENT;
+  }
+#ifndef SUDOKU_ZSTD
+  if (writer.compression == COMPRESSION_ZSTD)
+  {
+    return SUDOKU_ERROR_UNSUPPORTED_FORMAT;
+  }
+#endif
+
+  CorpusEncoder* encoder = new CorpusEncoder();
+  memset(&encoder->gzip, 0, sizeof(encoder->gzip));
+  if (writer.compression == COMPRESSION_GZIP &&
+      deflateInit2(&encoder->gzip, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+                   Z_DEFAULT_STRATEGY) != Z_OK)
+  {
+    delete encoder;
+    return SUDOKU_ERROR_WRITE_FAILED;
+  }
+#ifdef SUDOKU_ZSTD
+  encoder->zstd = NULL;
+  if (writer.compression == COMPRESSION_ZSTD && !(encoder->zstd = ZSTD_createCCtx()))
+  {
+    delete encoder;
+    return SUDOKU_ERROR_WRITE_FAILED;
+  }
+#endif
+
+  encoder->file = fopen(filename, "wb");
+  if (!encoder->file)
+  {
+    if (writer.compression == COMPRESSION_GZIP)
+    {
+      deflateEnd(&encoder->gzip);
+    }
+#ifdef SUDOKU_ZSTD
+    ZSTD_freeCCtx(encoder->zstd);
+#endif
+    delete encoder;
+    return SUDOKU_ERROR_OPEN_FAILED;
+  }
+  writer.encoder = encoder;
+  return SUDOKU_OK;
+}
+
+/**
+ * Writes data to a corpus file, compressing it in large blocks.
+ *
+ * Whole blocks are compressed straight from the caller's buffer; only data short of a block
+ * is copied and held back until more arrives.
+ *
+ * @param writer - an open writer.
+ * @param data - the bytes to write.
+ * @param length - the number of bytes.
+ *
+ * @return SUDOKU_OK - if the data was accepted, otherwise SUDOKU_ERROR_WRITE_FAILED.
+ */
+SudokuStatus corpus_write(CorpusWriter& writer, const char* data, size_t length)
+{
+  if (!writer.encoder || (!data && length))
+  {
+    return SUDOKU_ERROR_INVALID_ARGUMENT;
+  }
+  CorpusEncoder& encoder = *writer.encoder;
+  writer.data_bytes += length;
+
+  // Top up a block that is already part staged, so the stream still goes out in whole blocks
+  if (!encoder.pending.empty())
+  {
+    const size_t taken = min(length, BLOCK_SIZE - encoder.pending.size());
+    encoder.pending.append(data, taken);
+    data += taken;
+    length -= taken;
+    if (encoder.pending.size() < BLOCK_SIZE)
+    {
+      return SUDOKU_OK;
+    }
+    if (!flush_pending(writer, false))
+    {
+      return SUDOKU_ERROR_WRITE_FAILED;
+    }
+  }
+
+  // Whole blocks are compressed straight from the caller's buffer; only a short tail is copied
+  if (length >= BLOCK_SIZE)
+  {
+    return encode(writer, data, length, false) ? SUDOKU_OK : SUDOKU_ERROR_WRITE_FAILED;
+  }
+  encoder.pending.append(data, length);
+  return SUDOKU_OK;
+}
+
+/**
+ * Flushes and ends the compressed stream, and closes the file.
+ *
+ * @param writer - the writer to finish.
+ *
+ * @return SUDOKU_OK - if everything was written, otherwise SUDOKU_ERROR_WRITE_FAILED.
+ */
+SudokuStatus corpus_finish(CorpusWriter& writer)
+{
+  CorpusEncoder* encoder = writer.encoder;
+  if (!encoder)
+  {
+    return SUDOKU_ERROR_INVALID_ARGUMENT;
+  }
+
+  bool ok = flush_pending(writer, true);
+  if (writer.compression == COMPRESSION_GZIP)
+  {
+    deflateEnd(&encoder->gzip);
+  }
+#ifdef SUDOKU_ZSTD
+  ZSTD_freeCCtx(encoder->zstd);
+#endif
+  if (fclose(encoder->file) != 0)
+  {
+    ok = false;
+  }
+  delete encoder;
+  writer.encoder = NULL;
+  return ok ? SUDOKU_OK : SUDOKU_ERROR_WRITE_FAILED;
+}
@@ -0,0 +1,176 @@
+#ifndef CORPUS_IO_H
+#define CORPUS_IO_H
+
+#include <cstddef>
+#include <string>
+#include "sudoku.h"
+
+/* COMPRESSED CORPUS STREAMS */
+
+/**
+ * How a corpus file is stored.
+ *
+ * zstd is only available in builds made with "make ZSTD=1"; elsewhere zstd files are
+ * rejected with SUDOKU_ERROR_UNSUPPORTED_FORMAT.
+ */
+enum Compression
+{
+  COMPRESSION_NONE,
+  COMPRESSION_GZIP,
+  COMPRESSION_ZSTD
+};
+
+// The decompression thread and its queue of decoded chunks, private to corpus_io.cpp
+struct CorpusPipe;
+
+/**
+ * A corpus file open for reading, line by line.
+ *
+ * compression - the format of the file, detected from its first bytes.
+ * status - SUDOKU_OK, or why reading stopped early (set once corpus_read_line returns false).
+ * file_bytes - the number of bytes read from the file so far.
+ * data_bytes - the number of decompressed bytes handed to the reader so far.
+ */
+struct CorpusReader
+{
+  CorpusPipe* pipe;
+  Compression compression;
+  SudokuStatus status;
+  unsigned long long file_bytes;
+  unsigned long long data_bytes;
+};
+
+// The compressor state of a writer, private to corpus_io.cpp
+struct CorpusEncoder;
+
+/**
+ * A corpus or result file open for writing.
+ *
+ * compression - the format being written, chosen from the file name.
+ * file_bytes - the number of bytes written to the file so far.
+ * data_bytes - the number of uncompressed bytes passed to corpus_write so far.
+ */
+struct CorpusWriter
+{
+  CorpusEncoder* encoder;
+  Compression compression;
+  unsigned long long file_bytes;
+  unsigned long long data_bytes;
+};
+
+
+
+
+/**
+ * Returns the compression a file name asks for: ".gz" for gzip, ".zst" for zstd.
+ *
+ * @param filename - a constant character pointer to the file path.
+ *
+ * @return the compression matching the file's extension, or COMPRESSION_NONE.
+ */
+Compression compression_for_name(const char* filename);
+
+
+
+
+/**
+ * Returns a short name for a compression format ("none", "gzip" or "zstd").
+ *
+ * @param compression - the format to name.
+ *
+ * @return a constant C-string naming the format.
+ */
+const char* compression_name(Compression compression);
+
+
+
+
+/**
+ * Opens a corpus file for streaming, decompressing it on a thread of its own.
+ *
+ * The format is recognised from the magic bytes at the start of the file (1f 8b for gzip,
+ * 28 b5 2f fd for zstd), so a compressed file is read correctly whatever it is called;
+ * anything else is read as plain text. Concatenated gzip members and zstd frames are read
+ * as one stream.
+ *
+ * The thread reads and decompresses a few chunks ahead of the reader and then waits for it
+ * to catch up, so decompression overlaps with whatever the caller does with each line while
+ * memory use stays bounded however large the corpus is.
+ *
+ * @param filename - a constant character pointer to the corpus-file path.
+ * @param reader - the reader to open; it must be closed with corpus_close.
+ *
+ * @return SUDOKU_OK - if the file was opened, otherwise SUDOKU_ERROR_OPEN_FAILED,
+ *         SUDOKU_ERROR_UNSUPPORTED_FORMAT or SUDOKU_ERROR_WORKER_FAILED.
+ */
+SudokuStatus corpus_open(const char* filename, CorpusReader& reader);
+
+
+
+
+/**
+ * Reads the next line of a corpus.
+ *
+ * @param reader - an open reader.
+ * @param line - set to the line, without its "\n" or "\r\n".
+ *
+ * @return true - if a line was read, otherwise false at the end of the corpus or on an error
+ *         (told apart by reader.status).
+ */
+bool corpus_read_line(CorpusReader& reader, std::string& line);
+
+
+
+
+/**
+ * Stops the decompression thread and closes a corpus file.
+ *
+ * @param reader - the reader to close; its byte counters are left as they were.
+ */
+void corpus_close(CorpusReader& reader);
+
+
+
+
+/**
+ * Creates a file to write a corpus or results to, compressed as its name asks.
+ *
+ * @param filename - a constant character pointer to the output path; a name ending in ".gz"
+ *        is written as gzip and one ending in ".zst" as zstd.
+ * @param writer - the writer to open; it must be finished with corpus_finish.
+ *
+ * @return SUDOKU_OK - if the file was created, otherwise SUDOKU_ERROR_OPEN_FAILED or
+ *         SUDOKU_ERROR_UNSUPPORTED_FORMAT.
+ */
+SudokuStatus corpus_create(const char* filename, CorpusWriter& writer);
+
+
+
+
+/**
+ * Writes data to a corpus file, compressing it in large blocks.
+ *
+ * Whole blocks are compressed straight from the caller's buffer; only data short of a block
+ * is copied and held back until more arrives.
+ *
+ * @param writer - an open writer.
+ * @param data - the bytes to write.
+ * @param length - the number of bytes.
+ *
+ * @return SUDOKU_OK - if the data was accepted, otherwise SUDOKU_ERROR_WRITE_FAILED.
+ */
+SudokuStatus corpus_write(CorpusWriter& writer, const char* data, size_t length);
+
+
+
+
+/**
+ * Flushes and ends the compressed stream, and closes the file.
+ *
+ * @param writer - the writer to finish; it is closed even if the final write fails.
+ *
+ * @return SUDOKU_OK - if everything was written, otherwise SUDOKU_ERROR_WRITE_FAILED.
+ */
+SudokuStatus corpus_finish(CorpusWriter& writer);
+
+#endif
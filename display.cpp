@@ -0,0 +1,53 @@
+#include <iostream>
+#include <cstdlib>
+#include "sudoku.h"
+#include "display.h"
+
+using namespace std;
+
+/* pre-supplied function to load a Sudoku board from a file */
+void load_board(const char* filename, char board[9][9]) {
+
+  cout << "Loading Sudoku board from file '" << filename << "'... ";
+
+  SudokuStatus status = read_board_file(filename, board);
+  if (status != SUDOKU_OK) {
+    cout << "Failed! (" << sudoku_status_message(status) << ")\n";
+    exit(EXIT_FAILURE);
+  }
+
+  cout << "Success!\n";
+}
+
+/* internal helper function */
+void print_frame(int row) {
+  if (!(row % 3)) {
+    cout << "  +===========+===========+===========+\n";
+  } else {
+    cout << "  +---+---+---+---+---+---+---+---+---+\n";
+  }
+}
+
+/* internal helper function */
+void print_row(const char* data, int row) {
+  cout << (char) ('A' + row) << " ";
+  for (int i=0; i<9; i++) {
+    cout << ( (i % 3) ? ':' : '|' ) << " ";
+    cout << ( (data[i]=='.') ? ' ' : data[i]) << " ";
+  }
+  cout << "|\n";
+}
+
+/* pre-supplied function to display a Sudoku board */
+void display_board(const char board[9][9]) {
+  cout << "    ";
+  for (int r=0; r<9; r++) {
+    cout << (char) ('1'+r) << "   ";
+  }
+  cout << '\n';
+  for (int r=0; r<9; r++) {
+    print_frame(r);
+    print_row(board[r],r);
+  }
+  print_frame(9);
+}
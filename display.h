@@ -0,0 +1,30 @@
+#ifndef DISPLAY_H
+#define DISPLAY_H
+
+/* PREDEFINED HELPER FUNCTIONS */
+
+/* These print to cout, so they belong to the demonstration program rather than
+   the solver library. */
+
+/**
+ * Loads a sudoku board from a file, reporting progress on cout.
+ *
+ * This wraps the library's read_board_file with the messages of the original
+ * pre-supplied function. As before, a board that cannot be loaded ends the program.
+ *
+ * @param filename - a constant character pointer to the input-file path.
+ * @param board - a 9x9 character array that will hold the board.
+ */
+void load_board(const char* filename, char board[9][9]);
+
+
+
+
+/**
+ * Displays a sudoku board on cout with row letters and column numbers.
+ *
+ * @param board - a 9x9 character array representing the sudoku board.
+ */
+void display_board(const char board[9][9]);
+
+#endif
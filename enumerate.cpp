@@ -0,0 +1,130 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "enumerate.h"
+
+using namespace std;
+
+/* LAZY SOLUTION ENUMERATION */
+
+/**
+ * Returns a generator that continues an existing search.
+ *
+ * The search state lives in the coroutine frame, which is allocated once when the
+ * generator is created; each solution is yielded as a pointer into it.
+ *
+ * @param state - the search state to continue from (copied into the generator).
+ *
+ * @return a generator that produces each remaining solution of the search in turn.
+ */
+SolutionGenerator enumerate_solutions(SearchState state)
+{
+  while (search_next(state))
+  {
+    co_yield state.board;
+  }
+}
+
+/**
+ * Returns a generator over every solution of a board, in the order solve_board would meet them.
+ *
+ * @param board - a 9x9 character array representing the sudoku board.
+ *
+ * @return a generator that produces each solution in turn.
+ */
+SolutionGenerator enumerate_solutions(const char board[9][9])
+{
+  SearchState state;
+  search_init(state, board);
+  return enumerate_solutions(state);
+}
+
+/**
+ * Enumerates the solutions of a board on several threads.
+ *
+ * @param board - a 9x9 character array representing the sudoku board.
+ * @param threads - the number of worker threads to use (at least 1).
+ * @param limit - the maximum number of solutions to deliver, or 0 for all of them.
+ * @param visitor - called with each solution; may be empty to only count solutions.
+ *
+ * @return the number of solutions delivered to the visitor.
+ */
+long long enumerate_solutions_parallel(const char board[9][9], int threads, long long limit,
+                                       const SolutionVisitor& visitor)
+{
+  SearchState root;
+  search_init(root, board);
+  return enumerate_solutions_parallel(root, threads, limit, visitor);
+}
+
+/**
+ * Enumerates the remaining solutions of a search on several threads.
+ *
+ * @param root - a search state fresh from search_init.
+ * @param threads - the number of worker threads to use (at least 1).
+ * @param limit - the maximum number of solutions to deliver, or 0 for all of them.
+ * @param visitor - called with each solution; may be empty to only count solutions.
+ *
+ * @return the number of solutions delivered to the visitor.
+ */
+long long enumerate_solutions_parallel(const SearchState& root, int threads, long long limit,
+                                       const SolutionVisitor& visitor)
+{
+  if (threads < 1)
+  {
+    threads = 1;
+  }
+
+  // Fix more and more leading decisions until there are plenty of sub-searches to share out
+  vector<SearchState> parts;
+  const size_t wanted = (size_t) threads * 16;
+  for (int prefix = 1; ; prefix++)
+  {
+    parts.clear();
+    search_split(root, prefix, parts);
+    if (parts.size() >= wanted || prefix >= root.empty_count)
+    {
+      break;
+    }
+  }
+
+  atomic<size_t> next_part(0);
+  atomic<long long> delivered(0);
+  atomic<bool> stop(false);
+
+  auto worker = [&]()
+  {
+    size_t index;
+    while (!stop.load(memory_order_relaxed) && (index = next_part.fetch_add(1)) < parts.size())
+    {
+      SearchState& state = parts[index];
+      while (!stop.load(memory_order_relaxed) && search_next(state))
+      {
+        // Claim a place among the first 'limit' solutions before handing this one over
+        const long long position = delivered.fetch_add(1);
+        if (limit && position >= limit)
+        {
+          delivered.fetch_sub(1);
+          stop = true;
+          break;
+        }
+        if ((visitor && !visitor(state.board)) || (limit && position + 1 == limit))
+        {
+          stop = true;
+        }
+      }
+    }
+  };
+
+  vector<thread> pool;
+  for (int t = 1; t < threads; t++)
+  {
+    pool.push_back(thread(worker));
+  }
+  worker();
+  for (size_t t = 0; t < pool.size(); t++)
+  {
+    pool[t].join();
+  }
+  return delivered;
+}
@@ -0,0 +1,191 @@
+#ifndef ENUMERATE_H
+#define ENUMERATE_H
+
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include "search.h"
+
+/* LAZY SOLUTION ENUMERATION */
+
+/**
+ * A C++20 generator that produces the solutions of a board one at a time.
+ *
+ * The search only runs when the next solution is asked for, and stops again as soon as it
+ * has been found, so a consumer can stream any number of solutions (or just the first few)
+ * without holding them in memory. Each solution is a pointer to the board inside the
+ * coroutine frame: nothing is allocated per solution, and the pointed-to board is only valid
+ * until the generator is advanced again.
+ *
+ * Typical use:
+ *
+ *      for (const char (*solution)[9] : enumerate_solutions(board)) { ... }
+ */
+class SolutionGenerator
+{
+public:
+  struct promise_type
+  {
+    const char (*current)[9] = nullptr;
+    const SearchState* state;
+
+    // Called with the coroutine's own copy of its SearchState parameter
+    explicit promise_type(const SearchState& state) : state(&state) {}
+
+
+    SolutionGenerator get_return_object()
+    {
+      return SolutionGenerator(std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    std::suspend_always final_suspend() noexcept { return {}; }
+    std::suspend_always yield_value(const char (*board)[9]) noexcept
+    {
+      current = board;
+      return {};
+    }
+    void return_void() noexcept {}
+    void unhandled_exception() { std::terminate(); }
+  };
+
+  class iterator
+  {
+  public:
+    explicit iterator(SolutionGenerator* generator) : generator(generator) {}
+    const char (*operator*() const)[9] { return generator->board(); }
+    iterator& operator++()
+    {
+      if (!generator->next())
+      {
+        generator = nullptr;
+      }
+      return *this;
+    }
+    bool operator!=(const iterator& other) const { return generator != other.generator; }
+
+  private:
+    SolutionGenerator* generator;
+  };
+
+  SolutionGenerator(SolutionGenerator&& other) noexcept : handle(other.handle) { other.handle = nullptr; }
+  SolutionGenerator(const SolutionGenerator&) = delete;
+  SolutionGenerator& operator=(const SolutionGenerator&) = delete;
+  ~SolutionGenerator()
+  {
+    if (handle)
+    {
+      handle.destroy();
+    }
+  }
+
+  /**
+   * Resumes the search until the next solution is found.
+   *
+   * @return true - if another solution is available through board(), otherwise false.
+   */
+  bool next()
+  {
+    if (!handle || handle.done())
+    {
+      return false;
+    }
+    handle.resume();
+    return !handle.done();
+  }
+
+  /**
+   * Returns the most recent solution, valid until the generator is advanced.
+   */
+  const char (*board() const)[9] { return handle.promise().current; }
+
+  /**
+   * Returns the search state, e.g. for its node and backtrack counters.
+   */
+  const SearchState& state() const { return *handle.promise().state; }
+
+  iterator begin() { return next() ? iterator(this) : end(); }
+  iterator end() { return iterator(nullptr); }
+
+private:
+  explicit SolutionGenerator(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+
+  std::coroutine_handle<promise_type> handle;
+};
+
+
+
+
+/**
+ * Returns a generator over every solution of a board, in the order solve_board would meet them.
+ *
+ * The board is copied, so it does not need to outlive the generator.
+ *
+ * @param board - a 9x9 character array representing the sudoku board.
+ *
+ * @return a generator that produces each solution in turn.
+ */
+SolutionGenerator enumerate_solutions(const char board[9][9]);
+
+
+
+
+/**
+ * Returns a generator that continues an existing search.
+ *
+ * @param state - the search state to continue from (copied into the generator).
+ *
+ * @return a generator that produces each remaining solution of the search in turn.
+ */
+SolutionGenerator enumerate_solutions(SearchState state);
+
+
+
+
+/**
+ * Called for each solution found by enumerate_solutions_parallel; returning false stops
+ * the enumeration.
+ */
+typedef std::function<bool(const char board[9][9])> SolutionVisitor;
+
+
+
+
+/**
+ * Enumerates the solutions of a board on several threads.
+ *
+ * The search tree is split into sub-searches by fixing its first few decisions (see
+ * search_split), and a pool of threads takes sub-searches from a shared queue until they
+ * run out, the limit is reached or the visitor asks to stop. Solutions are delivered in no
+ * particular order, and the visitor is called concurrently from several threads, so it must
+ * be thread-safe.
+ *
+ * @param board - a 9x9 character array representing the sudoku board.
+ * @param threads - the number of worker threads to use (at least 1).
+ * @param limit - the maximum number of solutions to deliver, or 0 for all of them.
+ * @param visitor - called with each solution; may be empty to only count solutions.
+ *
+ * @return the number of solutions delivered to the visitor.
+ */
+long long enumerate_solutions_parallel(const char board[9][9], int threads, long long limit,
+                                       const SolutionVisitor& visitor);
+
+
+
+
+/**
+ * Enumerates the remaining solutions of a search on several threads.
+ *
+ * This is enumerate_solutions_parallel for a search that has already been set up, e.g.
+ * with search_init for a sudoku variant.
+ *
+ * @param root - a search state fresh from search_init.
+ * @param threads - the number of worker threads to use (at least 1).
+ * @param limit - the maximum number of solutions to deliver, or 0 for all of them.
+ * @param visitor - called with each solution; may be empty to only count solutions.
+ *
+ * @return the number of solutions delivered to the visitor.
+ */
+long long enumerate_solutions_parallel(const SearchState& root, int threads, long long limit,
+                                       const SolutionVisitor& visitor);
+
+#endif
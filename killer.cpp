@@ -0,0 +1,256 @@
+#include <fstream>
+#include <sstream>
+#include <string>
+#include "killer.h"
+
+using namespace std;
+
+/* INTERNAL HELPERS */
+
+// The largest sum of a cage: all nine digits
+static const int MAX_CAGE_SUM = 45;
+
+// combination_digits[cells][sum][used]: the digits of every set of 'cells' different digits,
+// avoiding 'used', that adds up to 'sum'
+static unsigned short combination_digits[10][MAX_CAGE_SUM + 1][512];
+
+/**
+ * Fills in combination_digits from every set of digits.
+ *
+ * Each of the 511 non-empty digit sets is added to the entry of every 'used' mask it
+ * avoids, which takes 3^9 steps in all.
+ *
+ * @return true, so the table can be built by a static initialiser.
+ */
+static bool build_combination_digits()
+{
+  for (unsigned short digits = 1; digits < 512; digits++)
+  {
+    const int cells = __builtin_popcount(digits);
+    int sum = 0;
+    for (int d = 0; d < 9; d++)
+    {
+      if (digits & (1 << d))
+      {
+        sum += d + 1;
+      }
+    }
+
+    // Visit every subset of the other digits, including the empty one
+    const unsigned short others = 0x1FF & ~digits;
+    unsigned short used = others;
+    while (true)
+    {
+      combination_digits[cells][sum][used] |= digits;
+      if (!used)
+      {
+        break;
+      }
+      used = (used - 1) & others;
+    }
+  }
+  return true;
+}
+
+/**
+ * Parses a cell name such as "A1" into a cell number.
+ *
+ * @param name - the cell name: a row letter 'A'-'I' and a column digit '1'-'9'.
+ * @param cell - a reference that will be set to row * 9 + column.
+ *
+ * @return true - if the name is valid, otherwise false.
+ */
+static bool parse_cell_name(const string& name, unsigned char& cell)
+{
+  if (name.size() != 2 || name[0] < 'A' || name[0] > 'I' || name[1] < '1' || name[1] > '9')
+  {
+    return false;
+  }
+  cell = (name[0] - 'A') * 9 + (name[1] - '1');
+  return true;
+}
+
+/* KILLER SUDOKU CAGES */
+
+/**
+ * Returns the digits that can still go into a killer cage.
+ *
+ * @param cells_left - the number of empty cells left in the cage (1-9).
+ * @param sum_left - what the empty cells must add up to.
+ * @param used - a bitmask of the digits already in the cage (bit d - 1 for digit d).
+ *
+ * @return a bitmask of the digits that can go in, or 0 if the cage cannot be completed.
+ */
+unsigned short cage_digits(int cells_left, int sum_left, unsigned short used)
+{
+  static const bool built = build_combination_digits();
+  (void) built;
+
+  if (cells_left < 1 || cells_left > 9 || sum_left < 1 || sum_left > MAX_CAGE_SUM)
+  {
+    return 0;
+  }
+  return combination_digits[cells_left][sum_left][used & 0x1FF];
+}
+
+/**
+ * Adds a killer cage to a topology.
+ *
+ * @param topology - the topology to add the cage to.
+ * @param sum - the sum of the cage.
+ * @param cells - the cells (row * 9 + column) of the cage.
+ * @param size - the number of cells (1-9).
+ *
+ * @return SUDOKU_OK - if the cage was added, otherwise SUDOKU_ERROR_INVALID_CAGE.
+ */
+SudokuStatus add_cage(Topology& topology, int sum, const unsigned char cells[], int size)
+{
+  if (!cells || size < 1 || size > 9 || topology.cage_count == MAX_CAGES ||
+      !cage_digits(size, sum, 0))
+  {
+    return SUDOKU_ERROR_INVALID_CAGE;
+  }
+  for (int k = 0; k < size; k++)
+  {
+    if (cells[k] >= 81 || topology.cell_cage[cells[k]] >= 0)
+    {
+      return SUDOKU_ERROR_INVALID_CAGE;
+    }
+    for (int j = 0; j < k; j++)
+    {
+      if (cells[j] == cells[k])
+      {
+        return SUDOKU_ERROR_INVALID_CAGE;
+      }
+    }
+  }
+
+  const int cage = topology.cage_count++;
+  topology.cage_size[cage] = size;
+  topology.cage_sum[cage] = sum;
+  for (int k = 0; k < size; k++)
+  {
+    topology.cage_cells[cage][k] = cells[k];
+    topology.cell_cage[cells[k]] = cage;
+  }
+
+  // The digits of a cage never repeat, so its cells are peers of each other; the cage's
+  // digits also become part of the hash the search keeps of its cells
+  for (int k = 0; k < size; k++)
+  {
+    for (int d = 0; d < 9; d++)
+    {
+      topology.placement_keys[cells[k]][d] ^= unit_digit_key(MAX_UNITS + cage, d);
+    }
+    for (int j = 0; j < size; j++)
+    {
+      if (j != k)
+      {
+        topology.peers[cells[k]][cells[j] / 64] |= 1ULL << (cells[j] % 64);
+      }
+    }
+  }
+  return SUDOKU_OK;
+}
+
+/**
+ * Parses a killer sudoku from a memory buffer: a board followed by its cages.
+ *
+ * @param buffer - the characters to parse (need not be null-terminated).
+ * @param length - the number of characters in the buffer.
+ * @param board - a 9x9 character array that will hold the board.
+ * @param topology - the topology the cages are added to.
+ *
+ * @return SUDOKU_OK - if the board and its cages were parsed, otherwise the code describing
+ *         the failure.
+ */
+SudokuStatus parse_killer_board(const char* buffer, size_t length, char board[9][9],
+                                Topology& topology)
+{
+  if (!buffer || !board)
+  {
+    return SUDOKU_ERROR_INVALID_ARGUMENT;
+  }
+
+  // Work on copies so a bad cage line leaves both the board and the topology alone
+  char parsed[9][9];
+  SudokuStatus status = parse_board(buffer, length, parsed);
+  if (status != SUDOKU_OK)
+  {
+    return status;
+  }
+  Topology caged = topology;
+
+  istringstream lines(string(buffer, length));
+  string line;
+  while (getline(lines, line))
+  {
+    istringstream words(line);
+    string keyword;
+    if (!(words >> keyword) || keyword != "cage")
+    {
+      continue;
+    }
+
+    int sum;
+    unsigned char cells[9];
+    int size = 0;
+    string name;
+    if (!(words >> sum))
+    {
+      return SUDOKU_ERROR_INVALID_CAGE;
+    }
+    while (words >> name)
+    {
+      if (size == 9 || !parse_cell_name(name, cells[size]))
+      {
+        return SUDOKU_ERROR_INVALID_CAGE;
+      }
+      size++;
+    }
+    status = add_cage(caged, sum, cells, size);
+    if (status != SUDOKU_OK)
+    {
+      return status;
+    }
+  }
+
+  for (int row = 0; row < 9; row++)
+  {
+    for (int column = 0; column < 9; column++)
+    {
+      board[row][column] = parsed[row][column];
+    }
+  }
+  topology = caged;
+  return SUDOKU_OK;
+}
+
+/**
+ * Reads a killer sudoku file (a board followed by cage lines).
+ *
+ * @param filename - a constant character pointer to the input-file path.
+ * @param board - a 9x9 character array that will hold the board.
+ * @param topology - the topology the cages are added to.
+ *
+ * @return SUDOKU_OK - if the board and its cages were read, otherwise the code describing
+ *         the failure.
+ */
+SudokuStatus read_killer_file(const char* filename, char board[9][9], Topology& topology)
+{
+  if (!filename)
+  {
+    return SUDOKU_ERROR_INVALID_ARGUMENT;
+  }
+
+  ifstream in(filename);
+  if (!in)
+  {
+    return SUDOKU_ERROR_OPEN_FAILED;
+  }
+
+  ostringstream contents;
+  contents << in.rdbuf();
+  const string text = contents.str();
+  return parse_killer_board(text.data(), text.size(), board, topology);
+}
@@ -0,0 +1,85 @@
+#ifndef KILLER_H
+#define KILLER_H
+
+#include <cstddef>
+#include "sudoku.h"
+#include "topology.h"
+
+/* KILLER SUDOKU CAGES */
+
+/**
+ * Returns the digits that can still go into a killer cage.
+ *
+ * A digit can go in if it belongs to at least one set of cells_left different digits,
+ * none of them already in the cage, that adds up to sum_left. The answer comes from a
+ * table precomputed over every (cells left, sum left, used digits) combination, so the
+ * check costs one lookup however far the search has got.
+ *
+ * @param cells_left - the number of empty cells left in the cage (1-9).
+ * @param sum_left - what the empty cells must add up to.
+ * @param used - a bitmask of the digits already in the cage (bit d - 1 for digit d).
+ *
+ * @return a bitmask of the digits that can go in, or 0 if the cage cannot be completed
+ *         (including when the arguments are out of range).
+ */
+unsigned short cage_digits(int cells_left, int sum_left, unsigned short used);
+
+
+
+
+/**
+ * Adds a killer cage to a topology.
+ *
+ * The cells of a cage must hold different digits adding up to its sum; they also become
+ * peers of each other, so is_move_valid and solve_board respect the cage too.
+ *
+ * @param topology - the topology to add the cage to.
+ * @param sum - the sum of the cage.
+ * @param cells - the cells (row * 9 + column) of the cage.
+ * @param size - the number of cells (1-9).
+ *
+ * @return SUDOKU_OK - if the cage was added, otherwise SUDOKU_ERROR_INVALID_CAGE (a cell
+ *         is out of range, repeated or already caged, or no digits can make the sum).
+ */
+SudokuStatus add_cage(Topology& topology, int sum, const unsigned char cells[], int size);
+
+
+
+
+/**
+ * Parses a killer sudoku from a memory buffer: a board followed by its cages.
+ *
+ * The board comes first, in either layout accepted by parse_board. Every later line of
+ * the form "cage <sum> <cell> <cell> ..." adds a cage, naming cells as make_move does
+ * ('A'-'I' for the row, '1'-'9' for the column), e.g. "cage 15 A1 A2 B1". Other lines
+ * are ignored, so a plain board parses as a killer sudoku with no cages.
+ *
+ * Neither the board nor the topology is changed unless the whole buffer parses.
+ *
+ * @param buffer - the characters to parse (need not be null-terminated).
+ * @param length - the number of characters in the buffer.
+ * @param board - a 9x9 character array that will hold the board.
+ * @param topology - the topology the cages are added to.
+ *
+ * @return SUDOKU_OK - if the board and its cages were parsed, otherwise the code describing
+ *         the failure.
+ */
+SudokuStatus parse_killer_board(const char* buffer, size_t length, char board[9][9],
+                                Topology& topology);
+
+
+
+
+/**
+ * Reads a killer sudoku file (a board followed by cage lines).
+ *
+ * @param filename - a constant character pointer to the input-file path.
+ * @param board - a 9x9 character array that will hold the board.
+ * @param topology - the topology the cages are added to.
+ *
+ * @return SUDOKU_OK - if the board and its cages were read, otherwise the code describing
+ *         the failure.
+ */
+SudokuStatus read_killer_file(const char* filename, char board[9][9], Topology& topology);
+
+#endif
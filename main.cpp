@@ -1,10 +1,18 @@
 #include <iostream>
 #include <cstdio>
 #include "sudoku.h"
+#include "display.h"
+#include "preflight.h"
+#include "cli.h"
 
 using namespace std;
 
-int main() {
+int main(int argc, char* argv[]) {
+
+  // Any arguments select one of the command-line modes instead of the demonstration
+  if (argc > 1) {
+    return run_command(argc, argv);
+  }
 
   char board[9][9];
 
@@ -214,6 +222,23 @@ int main() {
   cout << "Move score: " << total_valid_moves(board) << endl;
   solve_board(board, count);
   cout << "Backwards recursion score: " << count << endl << endl;
+
+  cout << "=================== Preflight ===================\n\n";
+
+  cout << "Checking each board for contradictions before searching.\n\n";
+
+  const char* boards[] = { "easy.dat", "medium.dat", "mystery1.dat", "mystery2.dat", "mystery3.dat" };
+  for (int i = 0; i < 5; i++)
+  {
+    load_board(boards[i], board);
+    PreflightResult result = preflight_board(board);
+    cout << "Preflight for '" << boards[i] << "': " << preflight_reason_message(result.reason);
+    if (result.forced_placements)
+    {
+      cout << " (after " << result.forced_placements << " forced digits)";
+    }
+    cout << "\n\n";
+  }
 	     
   return 0;
 }
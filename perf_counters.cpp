@@ -0,0 +1,206 @@
+#include <cstring>
+#include <ctime>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "perf_counters.h"
+
+/* INTERNAL HELPERS */
+
+/**
+ * Returns the current monotonic wall-clock time in nanoseconds.
+ */
+static long long now_ns()
+{
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (long long) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * Opens a single counting event for the calling thread.
+ *
+ * @param type - the perf event type (PERF_TYPE_HARDWARE or PERF_TYPE_HW_CACHE).
+ * @param config - the event configuration for that type.
+ *
+ * @return the file descriptor of the event, or -1 if it could not be opened.
+ */
+static int open_event(unsigned int type, unsigned long long config)
+{
+  perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = type;
+  attr.config = config;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+  return (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+/* PERFORMANCE COUNTERS */
+
+/**
+ * Opens a counter for each hardware event on the calling thread.
+ *
+ * @param counters - the counter set to open.
+ *
+ * @return the number of events that could be opened (0 if none are available).
+ */
+int perf_open(PerfCounters& counters)
+{
+  const unsigned long long l1d_read_miss = PERF_COUNT_HW_CACHE_L1D |
+                                           (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                           (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+
+  counters.fds[PERF_CYCLES] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+  counters.fds[PERF_INSTRUCTIONS] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+  counters.fds[PERF_BRANCH_MISSES] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+  counters.fds[PERF_L1D_MISSES] = open_event(PERF_TYPE_HW_CACHE, l1d_read_miss);
+  counters.fds[PERF_LLC_MISSES] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+
+  int opened = 0;
+  for (int event = 0; event < PERF_EVENT_COUNT; event++)
+  {
+    if (counters.fds[event] >= 0)
+    {
+      opened++;
+    }
+  }
+  return opened;
+}
+
+/**
+ * Closes every counter in the set.
+ *
+ * @param counters - the counter set to close.
+ */
+void perf_close(PerfCounters& counters)
+{
+  for (int event = 0; event < PERF_EVENT_COUNT; event++)
+  {
+    if (counters.fds[event] >= 0)
+    {
+      close(counters.fds[event]);
+      counters.fds[event] = -1;
+    }
+  }
+}
+
+/**
+ * Resets and starts every open counter, and records the wall-clock start time.
+ *
+ * @param counters - the counter set to start.
+ * @param sample - the sample that perf_stop will fill in.
+ */
+void perf_start(PerfCounters& counters, PerfSample& sample)
+{
+  for (int event = 0; event < PERF_EVENT_COUNT; event++)
+  {
+    if (counters.fds[event] >= 0)
+    {
+      ioctl(counters.fds[event], PERF_EVENT_IOC_RESET, 0);
+      ioctl(counters.fds[event], PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+  sample.start_ns = now_ns();
+}
+
+/**
+ * Stops every open counter and reads the counts since perf_start.
+ *
+ * @param counters - the counter set to stop.
+ * @param sample - the sample started by perf_start, filled in with the results.
+ */
+void perf_stop(PerfCounters& counters, PerfSample& sample)
+{
+  const long long end_ns = now_ns();
+
+  for (int event = 0; event < PERF_EVENT_COUNT; event++)
+  {
+    sample.values[event] = 0;
+    sample.valid[event] = false;
+    if (counters.fds[event] < 0)
+    {
+      continue;
+    }
+    ioctl(counters.fds[event], PERF_EVENT_IOC_DISABLE, 0);
+
+    // value, time enabled, time running
+    unsigned long long data[3];
+    if (read(counters.fds[event], data, sizeof(data)) != (ssize_t) sizeof(data) || !data[2])
+    {
+      continue;
+    }
+
+    // Scale up if the kernel only had the counter on the PMU for part of the time
+    double value = (double) data[0];
+    if (data[2] < data[1])
+    {
+      value *= (double) data[1] / (double) data[2];
+    }
+    sample.values[event] = (long long) value;
+    sample.valid[event] = true;
+  }
+  sample.seconds = (end_ns - sample.start_ns) / 1e9;
+}
+
+/**
+ * Adds the counts of one sample to a running total.
+ *
+ * @param total - the running total, which should start from perf_clear_sample.
+ * @param sample - the sample to add.
+ */
+void perf_accumulate(PerfSample& total, const PerfSample& sample)
+{
+  for (int event = 0; event < PERF_EVENT_COUNT; event++)
+  {
+    total.values[event] += sample.values[event];
+    total.valid[event] = total.valid[event] && sample.valid[event];
+  }
+  total.seconds += sample.seconds;
+}
+
+/**
+ * Resets a sample to zero counts with every event valid, ready for perf_accumulate.
+ *
+ * @param sample - the sample to clear.
+ */
+void perf_clear_sample(PerfSample& sample)
+{
+  for (int event = 0; event < PERF_EVENT_COUNT; event++)
+  {
+    sample.values[event] = 0;
+    sample.valid[event] = true;
+  }
+  sample.seconds = 0;
+  sample.start_ns = 0;
+}
+
+/**
+ * Returns the short name of an event (e.g. "cycles").
+ *
+ * @param event - the event to name.
+ *
+ * @return a constant C-string naming the event.
+ */
+const char* perf_event_name(int event)
+{
+  switch (event)
+  {
+    case PERF_CYCLES:
+      return "cycles";
+    case PERF_INSTRUCTIONS:
+      return "instructions";
+    case PERF_BRANCH_MISSES:
+      return "branch-misses";
+    case PERF_L1D_MISSES:
+      return "L1d-misses";
+    case PERF_LLC_MISSES:
+      return "LLC-misses";
+  }
+  return "unknown";
+}
@@ -0,0 +1,129 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+/* HARDWARE PERFORMANCE COUNTERS */
+
+/**
+ * The hardware events recorded around each measured region.
+ */
+enum PerfEvent
+{
+  PERF_CYCLES,
+  PERF_INSTRUCTIONS,
+  PERF_BRANCH_MISSES,
+  PERF_L1D_MISSES,
+  PERF_LLC_MISSES,
+  PERF_EVENT_COUNT
+};
+
+/**
+ * A set of open counters for the calling thread.
+ *
+ * fds - the perf_event_open file descriptor of each event, or -1 if the event
+ *       could not be opened (e.g. no PMU in a virtual machine, or a restrictive
+ *       perf_event_paranoid setting).
+ */
+struct PerfCounters
+{
+  int fds[PERF_EVENT_COUNT];
+};
+
+/**
+ * The counts measured over one region.
+ *
+ * values - the count of each event, scaled up if the kernel had to multiplex the counters.
+ * valid - whether each value was actually measured.
+ * seconds - the wall-clock time of the region, which is always measured.
+ */
+struct PerfSample
+{
+  long long values[PERF_EVENT_COUNT];
+  bool valid[PERF_EVENT_COUNT];
+  double seconds;
+  long long start_ns; // internal: the wall-clock start of the region
+};
+
+
+
+
+/**
+ * Opens a counter for each hardware event on the calling thread.
+ *
+ * Each event is opened on its own, so a machine that supports only some events still
+ * reports those. Events that cannot be opened are left disabled rather than treated
+ * as an error; only user-space activity is counted.
+ *
+ * @param counters - the counter set to open.
+ *
+ * @return the number of events that could be opened (0 if none are available).
+ */
+int perf_open(PerfCounters& counters);
+
+
+
+
+/**
+ * Closes every counter in the set.
+ *
+ * @param counters - the counter set to close.
+ */
+void perf_close(PerfCounters& counters);
+
+
+
+
+/**
+ * Resets and starts every open counter, and records the wall-clock start time.
+ *
+ * @param counters - the counter set to start.
+ * @param sample - the sample that perf_stop will fill in.
+ */
+void perf_start(PerfCounters& counters, PerfSample& sample);
+
+
+
+
+/**
+ * Stops every open counter and reads the counts since perf_start.
+ *
+ * @param counters - the counter set to stop.
+ * @param sample - the sample started by perf_start, filled in with the results.
+ */
+void perf_stop(PerfCounters& counters, PerfSample& sample);
+
+
+
+
+/**
+ * Adds the counts of one sample to a running total.
+ *
+ * An event is only valid in the total if it was valid in every sample added.
+ *
+ * @param total - the running total, which should start from perf_clear_sample.
+ * @param sample - the sample to add.
+ */
+void perf_accumulate(PerfSample& total, const PerfSample& sample);
+
+
+
+
+/**
+ * Resets a sample to zero counts with every event valid, ready for perf_accumulate.
+ *
+ * @param sample - the sample to clear.
+ */
+void perf_clear_sample(PerfSample& sample);
+
+
+
+
+/**
+ * Returns the short name of an event (e.g. "cycles").
+ *
+ * @param event - the event to name.
+ *
+ * @return a constant C-string naming the event.
+ */
+const char* perf_event_name(int event);
+
+#endif
@@ -0,0 +1,418 @@
+#include "killer.h"
+#include "preflight.h"
+
+/* INTERNAL HELPERS */
+
+// Bit (d - 1) of a mask is set when digit d is present / possible
+static const unsigned short ALL_DIGITS = 0x1FF;
+
+/**
+ * Builds a PreflightResult with every optional field cleared.
+ *
+ * @param reason - the reason to report.
+ *
+ * @return the new result.
+ */
+static PreflightResult make_result(PreflightReason reason)
+{
+  PreflightResult result;
+  result.reason = reason;
+  result.unit_type = -1;
+  result.unit_index = -1;
+  result.row = -1;
+  result.column = -1;
+  result.digit = '.';
+  result.forced_placements = 0;
+  return result;
+}
+
+/**
+ * Looks for an augmenting path from a cell in the cell/digit bipartite graph (Kuhn's algorithm).
+ *
+ * @param cell - the unit position of the cell to match.
+ * @param candidates - the candidate mask of every cell in the unit.
+ * @param visited - a mask of digits already tried on this search.
+ * @param digit_owner - for each digit, the unit position of the cell it is matched to, or -1.
+ *
+ * @return true - if the cell could be matched, otherwise false.
+ */
+static bool augment(int cell, const unsigned short candidates[9], unsigned short& visited,
+                    int digit_owner[9])
+{
+  for (int d = 0; d < 9; d++)
+  {
+    const unsigned short bit = 1 << d;
+    if ((candidates[cell] & bit) && !(visited & bit))
+    {
+      visited |= bit;
+      if (digit_owner[d] < 0 || augment(digit_owner[d], candidates, visited, digit_owner))
+      {
+        digit_owner[d] = cell;
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+/**
+ * Fills in the unit fields of a result from a unit of a topology.
+ *
+ * @param result - the result to fill in.
+ * @param topology - the units of the variant.
+ * @param unit - the unit the contradiction was found in.
+ */
+static void set_unit(PreflightResult& result, const Topology& topology, int unit)
+{
+  result.unit_type = topology.unit_type[unit];
+  result.unit_index = topology.unit_number[unit];
+}
+
+/**
+ * Runs every static check on a board once.
+ *
+ * @param board - a 9x9 character array representing the sudoku board.
+ * @param topology - the units of the variant.
+ * @param candidates - a 9x9 array that will be filled with the candidate mask of each cell
+ *        (0 for filled cells).
+ *
+ * @return the first contradiction found, or a result with reason PREFLIGHT_OK.
+ */
+static PreflightResult check_board(const char board[9][9], const Topology& topology,
+                                   unsigned short candidates[9][9])
+{
+  // used[unit] holds the digits already given in each unit
+  unsigned short used[MAX_UNITS] = {};
+
+  // Check every cell holds a legal character and no digit is repeated in a unit
+  for (int row = 0; row < 9; row++)
+  {
+    for (int column = 0; column < 9; column++)
+    {
+      const char cell = board[row][column];
+      if (cell == '.')
+      {
+        continue;
+      }
+      if (cell < '1' || cell > '9')
+      {
+        PreflightResult result = make_result(PREFLIGHT_INVALID_CHARACTER);
+        result.row = row;
+        result.column = column;
+        result.digit = cell;
+        return result;
+      }
+
+      const unsigned short bit = 1 << (cell - '1');
+      const int index = row * 9 + column;
+      for (int i = 0; i < topology.cell_unit_count[index]; i++)
+      {
+        const int unit = topology.cell_units[index][i];
+        if (used[unit] & bit)
+        {
+          PreflightResult result = make_result(PREFLIGHT_DUPLICATE_GIVEN);
+          set_unit(result, topology, unit);
+          result.row = row;
+          result.column = column;
+          result.digit = cell;
+          return result;
+        }
+        used[unit] |= bit;
+      }
+    }
+  }
+
+  // Check every killer cage has no repeated given and can still reach its sum
+  unsigned short cage_allowed[MAX_CAGES];
+  for (int cage = 0; cage < topology.cage_count; cage++)
+  {
+    unsigned short cage_used = 0;
+    int sum_left = topology.cage_sum[cage], cells_left = topology.cage_size[cage];
+    for (int k = 0; k < topology.cage_size[cage]; k++)
+    {
+      const int cell = topology.cage_cells[cage][k];
+      const char digit = board[cell / 9][cell % 9];
+      if (digit == '.')
+      {
+        continue;
+      }
+      if (cage_used & (1 << (digit - '1')))
+      {
+        PreflightResult result = make_result(PREFLIGHT_DUPLICATE_GIVEN);
+        result.unit_type = UNIT_CAGE;
+        result.unit_index = cage;
+        result.row = cell / 9;
+        result.column = cell % 9;
+        result.digit = digit;
+        return result;
+      }
+      cage_used |= 1 << (digit - '1');
+      sum_left -= digit - '0';
+      cells_left--;
+    }
+
+    cage_allowed[cage] = cells_left ? cage_digits(cells_left, sum_left, cage_used) : ALL_DIGITS;
+    if (cells_left ? !cage_allowed[cage] : sum_left != 0)
+    {
+      PreflightResult result = make_result(PREFLIGHT_CAGE_SUM);
+      result.unit_type = UNIT_CAGE;
+      result.unit_index = cage;
+      return result;
+    }
+  }
+
+  // Work out the candidates of every empty cell and check none are left without one
+  for (int row = 0; row < 9; row++)
+  {
+    for (int column = 0; column < 9; column++)
+    {
+      if (board[row][column] != '.')
+      {
+        candidates[row][column] = 0;
+        continue;
+      }
+      const int index = row * 9 + column;
+      unsigned short taken = 0;
+      for (int i = 0; i < topology.cell_unit_count[index]; i++)
+      {
+        taken |= used[topology.cell_units[index][i]];
+      }
+      const int cage = topology.cell_cage[index];
+      candidates[row][column] = (cage >= 0 ? cage_allowed[cage] : ALL_DIGITS) & ~taken;
+      if (!candidates[row][column])
+      {
+        PreflightResult result = make_result(PREFLIGHT_NO_CANDIDATES);
+        result.row = row;
+        result.column = column;
+        return result;
+      }
+    }
+  }
+
+  // Check each unit: every missing digit needs a cell, and the cells need a matching
+  for (int unit = 0; unit < topology.unit_count; unit++)
+  {
+    unsigned short unit_candidates[9];
+    unsigned short placeable = 0;
+    for (int k = 0; k < 9; k++)
+    {
+      const int cell = topology.units[unit][k];
+      unit_candidates[k] = candidates[cell / 9][cell % 9];
+      placeable |= unit_candidates[k];
+    }
+
+    const unsigned short missing = ALL_DIGITS & ~used[unit];
+    const unsigned short homeless = missing & ~placeable;
+    if (homeless)
+    {
+      PreflightResult result = make_result(PREFLIGHT_DIGIT_HAS_NO_PLACE);
+      set_unit(result, topology, unit);
+      result.digit = '1' + __builtin_ctz(homeless);
+      return result;
+    }
+
+    // Match empty cells to digits; any cell left unmatched breaks Hall's condition
+    int digit_owner[9] = { -1, -1, -1, -1, -1, -1, -1, -1, -1 };
+    for (int k = 0; k < 9; k++)
+    {
+      if (!unit_candidates[k])
+      {
+        continue;
+      }
+      unsigned short visited = 0;
+      if (!augment(k, unit_candidates, visited, digit_owner))
+      {
+        PreflightResult result = make_result(PREFLIGHT_HALL_VIOLATION);
+        set_unit(result, topology, unit);
+        result.row = topology.units[unit][k] / 9;
+        result.column = topology.units[unit][k] % 9;
+        return result;
+      }
+    }
+  }
+
+  return make_result(PREFLIGHT_OK);
+}
+
+/**
+ * Places a digit and removes it from the candidates of the cell's peers.
+ *
+ * @param board - a 9x9 character array representing the sudoku board, updated in place.
+ * @param topology - the units of the variant.
+ * @param candidates - the candidate masks, updated in place.
+ * @param cell - the cell to fill (row * 9 + column).
+ * @param d - the digit to place, from 0 for '1' to 8 for '9'.
+ */
+static void place_digit(char board[9][9], const Topology& topology,
+                        unsigned short candidates[9][9], int cell, int d)
+{
+  board[cell / 9][cell % 9] = '1' + d;
+  candidates[cell / 9][cell % 9] = 0;
+  for (int word = 0; word < 2; word++)
+  {
+    unsigned long long peers = topology.peers[cell][word];
+    while (peers)
+    {
+      const int peer = word * 64 + __builtin_ctzll(peers);
+      peers &= peers - 1;
+      candidates[peer / 9][peer % 9] &= ~(1 << d);
+    }
+  }
+}
+
+/**
+ * Fills in every naked single and hidden single on the board.
+ *
+ * A naked single is an empty cell with exactly one candidate; a hidden single is a digit
+ * that has exactly one possible cell in some unit. Both are forced, so placing them does
+ * not involve any guessing. Each placement removes its digit from its peers' candidates
+ * before the next single is looked for, so two singles that contradict each other are never
+ * both placed: the second loses its last candidate (or place) instead, and the next round
+ * of checks reports that.
+ *
+ * @param board - a 9x9 character array representing the sudoku board, updated in place.
+ * @param topology - the units of the variant.
+ * @param candidates - the candidate masks computed by check_board for this board, updated
+ *        in place.
+ *
+ * @return the number of digits placed.
+ */
+static int place_singles(char board[9][9], const Topology& topology,
+                         unsigned short candidates[9][9])
+{
+  int placed = 0;
+
+  for (int cell = 0; cell < 81; cell++)
+  {
+    const unsigned short mask = candidates[cell / 9][cell % 9];
+    if (mask && !(mask & (mask - 1)) && board[cell / 9][cell % 9] == '.')
+    {
+      place_digit(board, topology, candidates, cell, __builtin_ctz(mask));
+      placed++;
+    }
+  }
+
+  for (int unit = 0; unit < topology.unit_count; unit++)
+  {
+    for (int d = 0; d < 9; d++)
+    {
+      int places = 0, place = -1;
+      for (int k = 0; k < 9 && places < 2; k++)
+      {
+        const int cell = topology.units[unit][k];
+        if (candidates[cell / 9][cell % 9] & (1 << d))
+        {
+          places++;
+          place = cell;
+        }
+      }
+      if (places == 1 && board[place / 9][place % 9] == '.')
+      {
+        place_digit(board, topology, candidates, place, d);
+        placed++;
+      }
+    }
+  }
+  return placed;
+}
+
+/* PREFLIGHT ANALYSIS */
+
+/**
+ * Checks a classic sudoku board for contradictions without searching.
+ *
+ * @param board - a 9x9 character array representing the sudoku board.
+ *
+ * @return a PreflightResult describing the first contradiction found, with a reason of
+ *         PREFLIGHT_OK if the board passes every check.
+ */
+PreflightResult preflight_board(const char board[9][9])
+{
+  return preflight_board(board, classic_topology());
+}
+
+/**
+ * Checks a sudoku board for contradictions without searching.
+ *
+ * This function runs a series of increasingly strong checks on the board and
+ * stops at the first one that fails:
+ *      - Every cell holds either a digit ('1' to '9') or '.'.
+ *      - No digit is given twice in the same unit or killer cage of the topology.
+ *      - Every killer cage can still be completed to its sum with different digits.
+ *      - Every empty cell has at least one candidate digit.
+ *      - Every digit missing from a unit has at least one empty cell in that unit
+ *        it can be placed in.
+ *      - For every unit, the empty cells can be matched to the missing digits so
+ *        that each cell gets a different candidate (Hall's theorem, checked with
+ *        a bipartite matching between cells and digits).
+ *
+ * If the board passes, every forced digit (naked and hidden singles) is filled into a
+ * copy of the board and the checks are repeated, until nothing more is forced. The
+ * original board is never changed.
+ *
+ * @param board - a 9x9 character array representing the sudoku board.
+ * @param topology - the units of the variant.
+ *
+ * @return a PreflightResult describing the first contradiction found, with a reason of
+ *         PREFLIGHT_OK if the board passes every check.
+ */
+PreflightResult preflight_board(const char board[9][9], const Topology& topology)
+{
+  char work[9][9];
+  for (int row = 0; row < 9; row++)
+  {
+    for (int column = 0; column < 9; column++)
+    {
+      work[row][column] = board[row][column];
+    }
+  }
+
+  unsigned short candidates[9][9];
+  int forced = 0;
+  while (true)
+  {
+    PreflightResult result = check_board(work, topology, candidates);
+    result.forced_placements = forced;
+    if (result.reason != PREFLIGHT_OK)
+    {
+      return result;
+    }
+
+    // Keep going only while singles are still being found
+    const int placed = place_singles(work, topology, candidates);
+    if (!placed)
+    {
+      return result;
+    }
+    forced += placed;
+  }
+}
+
+/**
+ * Returns a short description of a preflight reason.
+ *
+ * @param reason - the reason to describe.
+ *
+ * @return a constant C-string describing the reason.
+ */
+const char* preflight_reason_message(PreflightReason reason)
+{
+  switch (reason)
+  {
+    case PREFLIGHT_OK:
+      return "no contradiction found";
+    case PREFLIGHT_INVALID_CHARACTER:
+      return "cell holds an invalid character";
+    case PREFLIGHT_DUPLICATE_GIVEN:
+      return "digit given twice in the same unit";
+    case PREFLIGHT_NO_CANDIDATES:
+      return "empty cell has no candidate digits";
+    case PREFLIGHT_DIGIT_HAS_NO_PLACE:
+      return "missing digit cannot be placed anywhere in its unit";
+    case PREFLIGHT_HALL_VIOLATION:
+      return "empty cells of a unit cannot all receive different digits";
+    case PREFLIGHT_CAGE_SUM:
+      return "killer cage cannot reach its sum";
+  }
+  return "unknown reason";
+}
@@ -0,0 +1,114 @@
+#ifndef PREFLIGHT_H
+#define PREFLIGHT_H
+
+#include "topology.h"
+
+/* PRE-SEARCH IMPOSSIBILITY DETECTION */
+
+/**
+ * Reasons a board can be rejected before any search takes place.
+ *
+ * PREFLIGHT_OK means that none of the checks found a contradiction. It does not
+ * prove that the board has a solution, only that the search is worth running.
+ */
+enum PreflightReason
+{
+  PREFLIGHT_OK,
+  PREFLIGHT_INVALID_CHARACTER, // a cell holds something other than '1'-'9' or '.'
+  PREFLIGHT_DUPLICATE_GIVEN,   // the same digit is given twice in one unit
+  PREFLIGHT_NO_CANDIDATES,     // an empty cell has no digit that can be placed in it
+  PREFLIGHT_DIGIT_HAS_NO_PLACE,// a digit missing from a unit fits none of its empty cells
+  PREFLIGHT_HALL_VIOLATION,    // the empty cells of a unit cannot all get different digits
+  PREFLIGHT_CAGE_SUM           // no set of different digits completes a killer cage's sum
+};
+
+/**
+ * The outcome of a preflight check.
+ *
+ * Only the fields that make sense for the reported reason are filled in; the rest
+ * are set to -1 (or '.' for the digit).
+ *
+ * reason - why the board was rejected, or PREFLIGHT_OK.
+ * unit_type - the kind of unit the contradiction was found in (a UnitType).
+ * unit_index - which row, column, subgrid, region or diagonal (subgrids numbered left to
+ *              right, top to bottom; regions in order of their first cell; the leading
+ *              diagonal is 0; cages in the order they were added).
+ * row, column - the cell the contradiction was found at.
+ * digit - the digit involved in the contradiction.
+ * forced_placements - how many forced digits (singles) had been filled in before the
+ *                     contradiction appeared; 0 means it is visible on the board as given.
+ */
+struct PreflightResult
+{
+  PreflightReason reason;
+  int unit_type;
+  int unit_index;
+  int row;
+  int column;
+  char digit;
+  int forced_placements;
+};
+
+
+
+
+/**
+ * Checks a sudoku board for contradictions without searching.
+ *
+ * This function runs a series of increasingly strong checks on the board and
+ * stops at the first one that fails:
+ *      - Every cell holds either a digit ('1' to '9') or '.'.
+ *      - No digit is given twice in the same row, column or 3x3 subgrid.
+ *      - Every empty cell has at least one candidate digit.
+ *      - Every digit missing from a unit has at least one empty cell in that unit
+ *        it can be placed in.
+ *      - For every unit, the empty cells can be matched to the missing digits so
+ *        that each cell gets a different candidate (Hall's theorem, checked with
+ *        a bipartite matching between cells and digits).
+ *
+ * If the board passes, every forced digit (naked and hidden singles) is filled into a
+ * copy of the board and the checks are repeated, until nothing more is forced. The
+ * original board is never changed.
+ *
+ * All checks use per-unit digit bitmasks, so the whole analysis takes a few
+ * microseconds regardless of how hard the board is to solve.
+ *
+ * @param board - a 9x9 character array representing the sudoku board.
+ *
+ * @return a PreflightResult describing the first contradiction found, with a reason of
+ *         PREFLIGHT_OK if the board passes every check.
+ */
+PreflightResult preflight_board(const char board[9][9]);
+
+
+
+
+/**
+ * Checks a board of a sudoku variant for contradictions without searching.
+ *
+ * This is preflight_board with every check applied to the units of a topology (its rows,
+ * columns, subgrids or jigsaw regions, and diagonals) instead of the classic ones. Killer
+ * cages are checked for repeated givens and unreachable sums, and limit the candidates
+ * of their cells to the digits of the sums still possible.
+ *
+ * @param board - a 9x9 character array representing the sudoku board.
+ * @param topology - the units of the variant.
+ *
+ * @return a PreflightResult describing the first contradiction found, with a reason of
+ *         PREFLIGHT_OK if the board passes every check.
+ */
+PreflightResult preflight_board(const char board[9][9], const Topology& topology);
+
+
+
+
+/**
+ * Returns a short description of a preflight reason.
+ *
+ * @param reason - the reason to describe.
+ *
+ * @return a constant C-string describing the reason.
+ */
+const char* preflight_reason_message(PreflightReason reason);
+
+#endif
@@ -0,0 +1,211 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "reduce.h"
+#include "search.h"
+
+using namespace std;
+
+/* INTERNAL HELPERS */
+
+/**
+ * Checks whether an empty cell is forced to a digit by the givens alone.
+ *
+ * @param board - the board, with the cell empty.
+ * @param topology - the units of the variant.
+ * @param cell - the cell (row * 9 + column).
+ * @param digit - the digit the cell must take.
+ *
+ * @return true - if the cell is a naked or hidden single for the digit, otherwise false.
+ */
+static bool is_forced(const char board[9][9], const Topology& topology, int cell, char digit)
+{
+  // Naked single: no other digit fits the cell
+  bool naked = true;
+  for (char other = '1'; other <= '9' && naked; other++)
+  {
+    naked = other == digit || !is_move_valid(cell / 9, cell % 9, other, board, topology);
+  }
+  if (naked)
+  {
+    return true;
+  }
+
+  // Hidden single: in one of the cell's units, no other empty cell can take the digit
+  for (int i = 0; i < topology.cell_unit_count[cell]; i++)
+  {
+    const unsigned char* unit = topology.units[topology.cell_units[cell][i]];
+    bool hidden = true;
+    for (int k = 0; k < 9 && hidden; k++)
+    {
+      hidden = unit[k] == cell ||
+               !is_move_valid(unit[k] / 9, unit[k] % 9, digit, board, topology);
+    }
+    if (hidden)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Checks whether a board has a solution that puts a different digit in a cell.
+ *
+ * @param board - the board, with the cell empty.
+ * @param topology - the units of the variant.
+ * @param cell - the cell (row * 9 + column).
+ * @param digit - the digit of the known solution in the cell.
+ * @param report - the report, whose probe and node counters are updated.
+ *
+ * @return true - if another solution exists, otherwise false.
+ */
+static bool has_other_solution(char board[9][9], const Topology& topology, int cell, char digit,
+                               ReduceReport& report)
+{
+  const int row = cell / 9, column = cell % 9;
+  bool found = false;
+  for (char other = '1'; other <= '9' && !found; other++)
+  {
+    if (other == digit || !is_move_valid(row, column, other, board, topology))
+    {
+      continue;
+    }
+    board[row][column] = other;
+    SearchState state;
+    search_init(state, board, topology);
+    found = search_next(state);
+    board[row][column] = '.';
+    report.probes++;
+    report.nodes += state.nodes;
+  }
+  return found;
+}
+
+/* MINIMAL PUZZLE REDUCTION */
+
+/**
+ * Removes clues from a classic puzzle until it is minimal.
+ *
+ * @param puzzle - a 9x9 character array representing the puzzle.
+ * @param minimal - a 9x9 character array that will hold the minimal puzzle.
+ * @param report - filled in with what the reduction did.
+ *
+ * @return true - if the puzzle had a unique solution and was reduced, otherwise false.
+ */
+bool reduce_puzzle(const char puzzle[9][9], char minimal[9][9], ReduceReport& report)
+{
+  return reduce_puzzle(puzzle, classic_topology(), minimal, report);
+}
+
+/**
+ * Removes clues from a puzzle of a sudoku variant until it is minimal.
+ *
+ * @param puzzle - a 9x9 character array representing the puzzle.
+ * @param topology - the units of the variant.
+ * @param minimal - a 9x9 character array that will hold the minimal puzzle.
+ * @param report - filled in with what the reduction did.
+ *
+ * @return true - if the puzzle had a unique solution and was reduced, otherwise false.
+ */
+bool reduce_puzzle(const char puzzle[9][9], const Topology& topology, char minimal[9][9],
+                   ReduceReport& report)
+{
+  report.solved = false;
+  report.unique = false;
+  report.clues_before = 0;
+  report.forced_removals = 0;
+  report.searched_removals = 0;
+  report.probes = 0;
+  report.nodes = 0;
+  for (int cell = 0; cell < 81; cell++)
+  {
+    minimal[cell / 9][cell % 9] = puzzle[cell / 9][cell % 9];
+    report.clues_before += puzzle[cell / 9][cell % 9] != '.';
+  }
+  report.clues = report.clues_before;
+
+  // The solution every removal must keep, and a check that it is the only one
+  SearchState state;
+  search_init(state, puzzle, topology);
+  report.solved = search_next(state);
+  report.unique = report.solved && !search_next(state);
+  report.nodes += state.nodes;
+  if (!report.unique)
+  {
+    return false;
+  }
+
+  for (int cell = 0; cell < 81; cell++)
+  {
+    const char digit = minimal[cell / 9][cell % 9];
+    if (digit == '.')
+    {
+      continue;
+    }
+
+    // The known solution keeps this clue's digit, so any second solution after the removal
+    // has to put another digit here, and only those need searching for
+    minimal[cell / 9][cell % 9] = '.';
+    if (is_forced(minimal, topology, cell, digit))
+    {
+      report.forced_removals++;
+    }
+    else if (!has_other_solution(minimal, topology, cell, digit, report))
+    {
+      report.searched_removals++;
+    }
+    else
+    {
+      minimal[cell / 9][cell % 9] = digit;
+      continue;
+    }
+    report.clues--;
+  }
+  return true;
+}
+
+/**
+ * Reduces many puzzles at once, sharing them out among several threads.
+ *
+ * @param puzzles - the puzzles.
+ * @param count - the number of puzzles.
+ * @param topology - the units of the variant.
+ * @param threads - the number of threads to use (at least 1).
+ * @param minimal - an array of count boards that will hold the minimal puzzles.
+ * @param reports - an array of count reports to fill in.
+ *
+ * @return the number of puzzles that had a unique solution and were reduced.
+ */
+size_t reduce_puzzles(const char (*puzzles)[9][9], size_t count, const Topology& topology,
+                      int threads, char (*minimal)[9][9], ReduceReport reports[])
+{
+  if (threads < 1)
+  {
+    threads = 1;
+  }
+
+  // Puzzles vary a lot in cost, so each thread takes the next one as soon as it is free
+  atomic<size_t> next_puzzle(0);
+  atomic<size_t> reduced(0);
+  auto worker = [&]()
+  {
+    size_t index;
+    while ((index = next_puzzle.fetch_add(1)) < count)
+    {
+      reduced += reduce_puzzle(puzzles[index], topology, minimal[index], reports[index]);
+    }
+  };
+
+  vector<thread> pool;
+  for (int t = 1; t < threads; t++)
+  {
+    pool.push_back(thread(worker));
+  }
+  worker();
+  for (size_t t = 0; t < pool.size(); t++)
+  {
+    pool[t].join();
+  }
+  return reduced;
+}
@@ -0,0 +1,99 @@
+#ifndef REDUCE_H
+#define REDUCE_H
+
+#include <cstddef>
+#include "topology.h"
+
+/* MINIMAL PUZZLE REDUCTION */
+
+/**
+ * What reducing a puzzle did.
+ *
+ * solved - whether the puzzle had a solution at all.
+ * unique - whether the puzzle had exactly one solution to begin with (nothing is reduced
+ *          otherwise).
+ * clues_before, clues - the number of givens before and after the reduction.
+ * forced_removals - clues removed without a search, because their cell would still be a
+ *                   naked or hidden single.
+ * searched_removals - clues removed after a search showed the solution stays unique.
+ * probes - the number of searches for a second solution.
+ * nodes - the number of digits placed, summed over every search.
+ */
+struct ReduceReport
+{
+  bool solved;
+  bool unique;
+  int clues_before;
+  int clues;
+  int forced_removals;
+  int searched_removals;
+  int probes;
+  long long nodes;
+};
+
+
+
+
+/**
+ * Removes clues from a puzzle until removing any other one would lose its unique solution.
+ *
+ * The puzzle is solved once. Its clues are then tried one at a time, in cell order, and a
+ * clue stays removed if the puzzle without it still has only that solution. Removing clues
+ * never takes solutions away, so a clue that has to stay cannot become removable later, and
+ * one pass gives a minimal puzzle.
+ *
+ * Most removals never need a search. If the cell would be a naked single (its peers rule
+ * out every other digit) or a hidden single (no other cell of one of its units can take
+ * its digit) the solution stays unique. Otherwise each other digit the cell could hold is
+ * placed in turn and the search stops at the first solution it finds, so a clue is kept as
+ * soon as one second solution turns up rather than after counting them.
+ *
+ * @param puzzle - a 9x9 character array representing the puzzle.
+ * @param minimal - a 9x9 character array that will hold the minimal puzzle (a copy of the
+ *        puzzle if it does not have exactly one solution).
+ * @param report - filled in with what the reduction did.
+ *
+ * @return true - if the puzzle had a unique solution and was reduced, otherwise false.
+ */
+bool reduce_puzzle(const char puzzle[9][9], char minimal[9][9], ReduceReport& report);
+
+
+
+
+/**
+ * Reduces a puzzle of a sudoku variant to a minimal one.
+ *
+ * This is reduce_puzzle with the units (and killer cages) of a topology.
+ *
+ * @param puzzle - a 9x9 character array representing the puzzle.
+ * @param topology - the units of the variant.
+ * @param minimal - a 9x9 character array that will hold the minimal puzzle.
+ * @param report - filled in with what the reduction did.
+ *
+ * @return true - if the puzzle had a unique solution and was reduced, otherwise false.
+ */
+bool reduce_puzzle(const char puzzle[9][9], const Topology& topology, char minimal[9][9],
+                   ReduceReport& report);
+
+
+
+
+/**
+ * Reduces many puzzles at once, sharing them out among several threads.
+ *
+ * Each puzzle is reduced exactly as reduce_puzzle would, so the results do not depend on the
+ * number of threads.
+ *
+ * @param puzzles - the puzzles.
+ * @param count - the number of puzzles.
+ * @param topology - the units of the variant.
+ * @param threads - the number of threads to use (at least 1).
+ * @param minimal - an array of count boards that will hold the minimal puzzles.
+ * @param reports - an array of count reports to fill in.
+ *
+ * @return the number of puzzles that had a unique solution and were reduced.
+ */
+size_t reduce_puzzles(const char (*puzzles)[9][9], size_t count, const Topology& topology,
+                      int threads, char (*minimal)[9][9], ReduceReport reports[]);
+
+#endif
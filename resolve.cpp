@@ -0,0 +1,200 @@
+#include "preflight.h"
+#include "resolve.h"
+#include "search.h"
+
+/* INTERNAL HELPERS */
+
+/**
+ * Searches the edited board with every cell outside a freed set held at its previous value.
+ *
+ * @param puzzle - the edited board.
+ * @param previous - the solution of the board before the edit.
+ * @param topology - the units of the variant.
+ * @param freed - which cells to clear and search again (givens are never cleared).
+ * @param solution - a 9x9 character array that will hold the solution, if one is found.
+ * @param report - the report, whose round and search counters are updated.
+ *
+ * @return true - if a solution was found, otherwise false.
+ */
+static bool search_freed(const char puzzle[9][9], const char previous[9][9],
+                         const Topology& topology, const bool freed[81], char solution[9][9],
+                         ResolveReport& report)
+{
+  char board[9][9];
+  report.freed_cells = 0;
+  for (int cell = 0; cell < 81; cell++)
+  {
+    const int row = cell / 9, column = cell % 9;
+    if (puzzle[row][column] != '.')
+    {
+      board[row][column] = puzzle[row][column];
+    }
+    else if (freed[cell])
+    {
+      board[row][column] = '.';
+      report.freed_cells++;
+    }
+    else
+    {
+      board[row][column] = previous[row][column];
+    }
+  }
+
+  // Held cells that clash with the givens make the board fail its preflight straight away
+  SearchState state;
+  search_init(state, board, topology);
+  const bool found = search_next(state);
+  report.rounds++;
+  report.nodes += state.nodes;
+  report.backtracks += state.backtracks;
+
+  if (found)
+  {
+    for (int row = 0; row < 9; row++)
+    {
+      for (int column = 0; column < 9; column++)
+      {
+        solution[row][column] = state.board[row][column];
+      }
+    }
+  }
+  return found;
+}
+
+/* INCREMENTAL RE-SOLVING */
+
+/**
+ * Re-solves a classic board after some of its givens were edited.
+ *
+ * @param puzzle - the edited board: its givens, with '.' for empty cells.
+ * @param previous - the solution of the board before the edit.
+ * @param solution - a 9x9 character array that will hold the new solution.
+ * @param report - filled in with what the re-solve did.
+ *
+ * @return true - if the edited board has a solution, otherwise false.
+ */
+bool resolve_board(const char puzzle[9][9], const char previous[9][9], char solution[9][9],
+                   ResolveReport& report)
+{
+  return resolve_board(puzzle, previous, classic_topology(), solution, report);
+}
+
+/**
+ * Re-solves a board of a sudoku variant after an edit, starting from its previous solution.
+ *
+ * @param puzzle - the edited board: its givens, with '.' for empty cells.
+ * @param previous - the solution of the board before the edit.
+ * @param topology - the units of the variant.
+ * @param solution - a 9x9 character array that will hold the new solution.
+ * @param report - filled in with what the re-solve did.
+ *
+ * @return true - if the edited board has a solution, otherwise false.
+ */
+bool resolve_board(const char puzzle[9][9], const char previous[9][9], const Topology& topology,
+                   char solution[9][9], ResolveReport& report)
+{
+  report.method = RESOLVE_REUSED;
+  report.rounds = 0;
+  report.freed_cells = 0;
+  report.nodes = 0;
+  report.backtracks = 0;
+
+  // Find the givens the previous solution disagrees with, and the digits involved
+  bool complete = true;
+  unsigned short moved_digits = 0;
+  int empty_cells = 0;
+  for (int row = 0; row < 9; row++)
+  {
+    for (int column = 0; column < 9; column++)
+    {
+      const char old_digit = previous[row][column], given = puzzle[row][column];
+      if (old_digit < '1' || old_digit > '9')
+      {
+        complete = false;
+        continue;
+      }
+      if (given == '.')
+      {
+        empty_cells++;
+      }
+      else if (given != old_digit && given >= '1' && given <= '9')
+      {
+        moved_digits |= (1 << (given - '1')) | (1 << (old_digit - '1'));
+      }
+    }
+  }
+
+  // The previous solution is kept as it is if it fits every given and is still valid
+  bool freed[81] = {};
+  if (complete && !moved_digits && preflight_board(previous, topology).reason == PREFLIGHT_OK)
+  {
+    for (int row = 0; row < 9; row++)
+    {
+      for (int column = 0; column < 9; column++)
+      {
+        solution[row][column] = previous[row][column];
+      }
+    }
+    return true;
+  }
+
+  if (complete)
+  {
+    // The region that depends on the edit: every cell sharing a unit with an edited given
+    bool dependent[81] = {};
+    for (int cell = 0; cell < 81; cell++)
+    {
+      const char given = puzzle[cell / 9][cell % 9];
+      if (given == '.' || given == previous[cell / 9][cell % 9])
+      {
+        continue;
+      }
+      for (int peer = 0; peer < 81; peer++)
+      {
+        if ((topology.peers[cell][peer / 64] >> (peer % 64)) & 1)
+        {
+          dependent[peer] = true;
+        }
+      }
+    }
+
+    // Repair by moving the digits the edit touched, then one more digit each round, with
+    // the dependent region always free; every other cell keeps its previous digit. A
+    // round that cannot work usually fails its preflight check without placing anything.
+    report.method = RESOLVE_REPAIRED;
+    unsigned short digits = moved_digits;
+    while (true)
+    {
+      for (int cell = 0; cell < 81; cell++)
+      {
+        const char old_digit = previous[cell / 9][cell % 9];
+        freed[cell] = dependent[cell] || ((digits >> (old_digit - '1')) & 1);
+      }
+      const bool found = search_freed(puzzle, previous, topology, freed, solution, report);
+      if (report.freed_cells == empty_cells)
+      {
+        // Every cell was free, so this round was a cold solve
+        report.method = found ? RESOLVE_COLD : RESOLVE_UNSOLVABLE;
+        return found;
+      }
+      if (found)
+      {
+        return true;
+      }
+      digits |= (digits + 1) & ~digits;
+    }
+  }
+
+  // Cold solve: clear everything but the givens
+  for (int cell = 0; cell < 81; cell++)
+  {
+    freed[cell] = true;
+  }
+  report.method = RESOLVE_COLD;
+  if (search_freed(puzzle, previous, topology, freed, solution, report))
+  {
+    return true;
+  }
+  report.method = RESOLVE_UNSOLVABLE;
+  return false;
+}
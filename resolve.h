@@ -0,0 +1,84 @@
+#ifndef RESOLVE_H
+#define RESOLVE_H
+
+#include "topology.h"
+
+/* INCREMENTAL RE-SOLVING */
+
+/**
+ * How a re-solve found its answer.
+ */
+enum ResolveMethod
+{
+  RESOLVE_REUSED,     // the previous solution still fits the new givens
+  RESOLVE_REPAIRED,   // only the cells around the edit were searched again
+  RESOLVE_COLD,       // no local repair worked, so the whole board was searched
+  RESOLVE_UNSOLVABLE  // the edited board has no solution
+};
+
+/**
+ * What a re-solve did.
+ *
+ * method - how the answer was found.
+ * rounds - the number of searches run (0 if the previous solution was reused).
+ * freed_cells - the number of cells cleared for the last search.
+ * nodes, backtracks - the search counters, summed over every round.
+ */
+struct ResolveReport
+{
+  ResolveMethod method;
+  int rounds;
+  int freed_cells;
+  long long nodes;
+  long long backtracks;
+};
+
+
+
+
+/**
+ * Re-solves a board after some of its givens were edited, starting from its previous solution.
+ *
+ * If the previous solution agrees with every new given it is returned at once. Otherwise
+ * only part of the board is searched again, with the rest of the previous solution held
+ * fixed: the cells sharing a unit with an edited given, and every cell holding one of the
+ * digits the edit swapped. While that has no solution one more digit's cells are freed
+ * each round, so the last round is a cold solve and an answer is always found if one
+ * exists. Rounds that cannot succeed are usually refuted by the preflight check before
+ * placing a single digit.
+ *
+ * When the edited board has several solutions, the one returned is the one closest to
+ * the previous solution that the repair finds, which need not be the first solution a
+ * cold solve would meet.
+ *
+ * @param puzzle - the edited board: its givens, with '.' for empty cells.
+ * @param previous - the solution of the board before the edit.
+ * @param solution - a 9x9 character array that will hold the new solution (unchanged if
+ *        there is none).
+ * @param report - filled in with what the re-solve did.
+ *
+ * @return true - if the edited board has a solution, otherwise false.
+ */
+bool resolve_board(const char puzzle[9][9], const char previous[9][9], char solution[9][9],
+                   ResolveReport& report);
+
+
+
+
+/**
+ * Re-solves a board of a sudoku variant after an edit, starting from its previous solution.
+ *
+ * This is resolve_board with the units (and killer cages) of a topology.
+ *
+ * @param puzzle - the edited board: its givens, with '.' for empty cells.
+ * @param previous - the solution of the board before the edit.
+ * @param topology - the units of the variant.
+ * @param solution - a 9x9 character array that will hold the new solution.
+ * @param report - filled in with what the re-solve did.
+ *
+ * @return true - if the edited board has a solution, otherwise false.
+ */
+bool resolve_board(const char puzzle[9][9], const char previous[9][9], const Topology& topology,
+                   char solution[9][9], ResolveReport& report);
+
+#endif
@@ -0,0 +1,474 @@
+#include <charconv>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "result_writer.h"
+
+using namespace std;
+
+/* INTERNAL HELPERS */
+
+// How much formatted output is gathered before it is written out
+static const size_t BUFFER_SIZE = 1 << 20;
+
+/**
+ * The buffers of a result writer and, if it has one, its background thread.
+ *
+ * The caller formats records into buffer. A full buffer is swapped with the empty handoff
+ * buffer and the thread writes it out with the lock released; until it sets queued back to
+ * false the handoff buffer belongs to the thread alone. Both buffers keep their capacity, so
+ * after the first two fills nothing more is allocated.
+ */
+struct ResultSink
+{
+  CorpusWriter file;
+  string buffer;
+  bool background;
+  thread worker;
+
+  mutex lock;
+  condition_variable changed;
+  string handoff;
+  bool queued;
+  bool stop;
+  SudokuStatus status;
+};
+
+/**
+ * Writes buffers out as the caller hands them over, until told to stop.
+ *
+ * @param sink - the sink of the writer.
+ */
+static void write_buffers(ResultSink* sink)
+{
+  unique_lock<mutex> guard(sink->lock);
+  while (true)
+  {
+    sink->changed.wait(guard, [&] { return sink->queued || sink->stop; });
+    if (!sink->queued)
+    {
+      return;
+    }
+    guard.unlock();
+    const SudokuStatus status = corpus_write(sink->file, sink->handoff.data(),
+                                             sink->handoff.size());
+    sink->handoff.clear();
+    guard.lock();
+    if (sink->status == SUDOKU_OK)
+    {
+      sink->status = status;
+    }
+    sink->queued = false;
+    sink->changed.notify_all();
+  }
+}
+
+/**
+ * Writes out the caller's buffer, or hands it to the background thread.
+ *
+ * @param writer - the writer.
+ */
+static void flush_buffer(ResultWriter& writer)
+{
+  ResultSink& sink = *writer.sink;
+  if (!sink.background)
+  {
+    const SudokuStatus status = corpus_write(sink.file, sink.buffer.data(), sink.buffer.size());
+    sink.buffer.clear();
+    if (writer.status == SUDOKU_OK)
+    {
+      writer.status = status;
+    }
+    return;
+  }
+
+  unique_lock<mutex> guard(sink.lock);
+  sink.changed.wait(guard, [&] { return !sink.queued; });
+  sink.buffer.swap(sink.handoff);
+  sink.queued = true;
+  if (writer.status == SUDOKU_OK)
+  {
+    writer.status = sink.status;
+  }
+  sink.changed.notify_all();
+}
+
+/**
+ * Appends an integer in decimal.
+ */
+static void append_integer(string& out, long long value)
+{
+  char digits[24];
+  const to_chars_result end = to_chars(digits, digits + sizeof(digits), value);
+  out.append(digits, end.ptr - digits);
+}
+
+/**
+ * Appends a time in microseconds, to a tenth of a microsecond.
+ */
+static void append_microseconds(string& out, double seconds)
+{
+  char digits[32];
+  const to_chars_result end = to_chars(digits, digits + sizeof(digits), seconds * 1e6,
+                                       chars_format::fixed, 1);
+  out.append(digits, end.ptr - digits);
+}
+
+/**
+ * Appends text as a JSON string, escaping quotes, backslashes and control characters.
+ */
+static void append_json_string(string& out, const char* text)
+{
+  out.push_back('"');
+  for (const char* c = text; *c; c++)
+  {
+    if (*c == '"' || *c == '\\')
+    {
+      out.push_back('\\');
+      out.push_back(*c);
+    }
+    else if ((unsigned char) *c < 0x20)
+    {
+      static const char hex[] = "0123456789abcdef";
+      out.append("\\u00");
+      out.push_back(hex[(*c >> 4) & 0xF]);
+      out.push_back(hex[*c & 0xF]);
+    }
+    else
+    {
+      out.push_back(*c);
+    }
+  }
+  out.push_back('"');
+}
+
+/**
+ * Appends text as a CSV field, quoting it only if it holds a comma, quote or line break.
+ */
+static void append_csv_field(string& out, const char* text)
+{
+  if (!strpbrk(text, ",\"\r\n"))
+  {
+    out.append(text);
+    return;
+  }
+  out.push_back('"');
+  for (const char* c = text; *c; c++)
+  {
+    if (*c == '"')
+    {
+      out.push_back('"');
+    }
+    out.push_back(*c);
+  }
+  out.push_back('"');
+}
+
+/**
+ * Counts the givens of a puzzle.
+ */
+static int count_clues(const char board[9][9])
+{
+  int clues = 0;
+  for (int cell = 0; cell < 81; cell++)
+  {
+    clues += board[cell / 9][cell % 9] != '.' && board[cell / 9][cell % 9] != '0';
+  }
+  return clues;
+}
+
+/**
+ * Formats a record as one line of CSV.
+ */
+static void format_csv(string& out, const ResultRecord& record)
+{
+  append_integer(out, record.index);
+  out.push_back(',');
+  append_csv_field(out, record.engine);
+  out.append(record.solved ? ",yes," : ",no,");
+  append_integer(out, count_clues(record.puzzle));
+  out.push_back(',');
+  append_microseconds(out, record.sample.seconds);
+  for (int event = 0; event < PERF_EVENT_COUNT; event++)
+  {
+    out.push_back(',');
+    if (record.sample.valid[event])
+    {
+      append_integer(out, record.sample.values[event]);
+    }
+  }
+  out.push_back(',');
+  out.append(&record.puzzle[0][0], 81);
+  out.push_back(',');
+  if (record.solved)
+  {
+    out.append(&record.board[0][0], 81);
+  }
+  out.push_back('\n');
+}
+
+/**
+ * Formats a record as one JSON object on a line of its own.
+ */
+static void format_jsonl(string& out, const ResultRecord& record)
+{
+  out.append("{\"index\":");
+  append_integer(out, record.index);
+  out.append(",\"engine\":");
+  append_json_string(out, record.engine);
+  out.append(record.solved ? ",\"solved\":true,\"clues\":" : ",\"solved\":false,\"clues\":");
+  append_integer(out, count_clues(record.puzzle));
+  out.append(",\"time_us\":");
+  append_microseconds(out, record.sample.seconds);
+  for (int event = 0; event < PERF_EVENT_COUNT; event++)
+  {
+    if (record.sample.valid[event])
+    {
+      out.push_back(',');
+      append_json_string(out, perf_event_name(event));
+      out.push_back(':');
+      append_integer(out, record.sample.values[event]);
+    }
+  }
+  out.append(",\"puzzle\":\"");
+  out.append(&record.puzzle[0][0], 81);
+  if (record.solved)
+  {
+    out.append("\",\"solution\":\"");
+    out.append(&record.board[0][0], 81);
+    out.append("\"}\n");
+  }
+  else
+  {
+    out.append("\",\"solution\":null}\n");
+  }
+}
+
+/* BUFFERED RESULT FILES */
+
+/**
+ * Returns the layout a file name asks for.
+ *
+ * @param filename - a constant character pointer to the file path.
+ *
+ * @return the format matching the file's extension.
+ */
+ResultFormat result_format_for_name(const char* filename)
+{
+  if (!filename)
+  {
+    return RESULT_FORMAT_LINE;
+  }
+  string name = filename;
+  if (compression_for_name(filename) != COMPRESSION_NONE)
+  {
+    name.erase(name.rfind('.'));
+  }
+
+  const size_t dot = name.rfind('.');
+  const string extension = dot == string::npos ? "" : name.substr(dot);
+  if (extension == ".dat")
+  {
+    return RESULT_FORMAT_DAT;
+  }
+  if (extension == ".csv")
+  {
+    return RESULT_FORMAT_CSV;
+  }
+  if (extension == ".jsonl" || extension == ".json")
+  {
+    return RESULT_FORMAT_JSONL;
+  }
+  return RESULT_FORMAT_LINE;
+}
+
+/**
+ * Returns the name of a result layout.
+ *
+ * @param format - the layout to name.
+ *
+ * @return a constant C-string naming the layout.
+ */
+const char* result_format_name(ResultFormat format)
+{
+  switch (format)
+  {
+    case RESULT_FORMAT_DAT:
+      return "dat";
+    case RESULT_FORMAT_LINE:
+      return "line";
+    case RESULT_FORMAT_CSV:
+      return "csv";
+    case RESULT_FORMAT_JSONL:
+      return "jsonl";
+  }
+  return "unknown";
+}
+
+/**
+ * Creates a result file, compressed as its name asks.
+ *
+ * @param filename - a constant character pointer to the output path.
+ * @param format - the layout of the records.
+ * @param background - whether to write on a thread of its own.
+ * @param writer - the writer to open.
+ *
+ * @return SUDOKU_OK - if the file was created, otherwise the code describing the failure.
+ */
+SudokuStatus result_open(const char* filename, ResultFormat format, bool background,
+                         ResultWriter& writer)
+{
+  writer.sink = NULL;
+  writer.format = format;
+  writer.compression = compression_for_name(filename);
+  writer.records = 0;
+  writer.file_bytes = 0;
+  writer.data_bytes = 0;
+  writer.status = SUDOKU_OK;
+
+  ResultSink* sink = new ResultSink();
+  const SudokuStatus status = corpus_create(filename, sink->file);
+  if (status != SUDOKU_OK)
+  {
+    delete sink;
+    return status;
+  }
+  sink->buffer.reserve(BUFFER_SIZE + 256);
+  sink->background = background;
+  sink->queued = false;
+  sink->stop = false;
+  sink->status = SUDOKU_OK;
+  writer.sink = sink;
+  if (background)
+  {
+    sink->handoff.reserve(BUFFER_SIZE + 256);
+    try
+    {
+      sink->worker = thread(write_buffers, sink);
+    }
+    catch (...)
+    {
+      corpus_finish(sink->file);
+      delete sink;
+      writer.sink = NULL;
+      return SUDOKU_ERROR_WORKER_FAILED;
+    }
+  }
+
+  if (format == RESULT_FORMAT_CSV)
+  {
+    sink->buffer.append("index,engine,solved,clues,time_us");
+    for (int event = 0; event < PERF_EVENT_COUNT; event++)
+    {
+      sink->buffer.push_back(',');
+      sink->buffer.append(perf_event_name(event));
+    }
+    sink->buffer.append(",puzzle,solution\n");
+  }
+  return SUDOKU_OK;
+}
+
+/**
+ * Formats a record into the writer's buffer, writing the buffer out if it is full.
+ *
+ * @param writer - an open writer.
+ * @param record - the record to write.
+ *
+ * @return SUDOKU_OK - if the record was accepted, otherwise the failure.
+ */
+SudokuStatus result_write(ResultWriter& writer, const ResultRecord& record)
+{
+  if (!writer.sink || !record.engine || !record.puzzle || !record.board)
+  {
+    return SUDOKU_ERROR_INVALID_ARGUMENT;
+  }
+  if (writer.status != SUDOKU_OK)
+  {
+    return writer.status;
+  }
+
+  string& out = writer.sink->buffer;
+  const char (*board)[9] = record.solved ? record.board : record.puzzle;
+  switch (writer.format)
+  {
+    case RESULT_FORMAT_DAT:
+      for (int row = 0; row < 9; row++)
+      {
+        out.append(board[row], 9);
+        out.push_back('\n');
+      }
+      out.push_back('\n');
+      break;
+    case RESULT_FORMAT_LINE:
+      if (record.solved)
+      {
+        out.append(&board[0][0], 81);
+        out.push_back('\n');
+      }
+      else
+      {
+        out.append("unsolvable\n");
+      }
+      break;
+    case RESULT_FORMAT_CSV:
+      format_csv(out, record);
+      break;
+    case RESULT_FORMAT_JSONL:
+      format_jsonl(out, record);
+      break;
+  }
+  writer.records++;
+
+  if (out.size() >= BUFFER_SIZE)
+  {
+    flush_buffer(writer);
+  }
+  return writer.status;
+}
+
+/**
+ * Writes out whatever is buffered, stops the background thread and closes the file.
+ *
+ * @param writer - the writer to close.
+ *
+ * @return SUDOKU_OK - if every record was written, otherwise the first failure.
+ */
+SudokuStatus result_close(ResultWriter& writer)
+{
+  ResultSink* sink = writer.sink;
+  if (!sink)
+  {
+    return SUDOKU_ERROR_INVALID_ARGUMENT;
+  }
+
+  if (!sink->buffer.empty())
+  {
+    flush_buffer(writer);
+  }
+  if (sink->background)
+  {
+    {
+      lock_guard<mutex> guard(sink->lock);
+      sink->stop = true;
+      sink->changed.notify_all();
+    }
+    sink->worker.join();
+    if (writer.status == SUDOKU_OK)
+    {
+      writer.status = sink->status;
+    }
+  }
+
+  const SudokuStatus status = corpus_finish(sink->file);
+  if (writer.status == SUDOKU_OK)
+  {
+    writer.status = status;
+  }
+  writer.file_bytes = sink->file.file_bytes;
+  writer.data_bytes = sink->file.data_bytes;
+  delete sink;
+  writer.sink = NULL;
+  return writer.status;
+}
@@ -0,0 +1,149 @@
+#ifndef RESULT_WRITER_H
+#define RESULT_WRITER_H
+
+#include <cstddef>
+#include "corpus_io.h"
+#include "perf_counters.h"
+#include "sudoku.h"
+
+/* BUFFERED RESULT FILES */
+
+/**
+ * How the records of a result file are laid out.
+ *
+ * RESULT_FORMAT_DAT - each solution in the nine-line .dat layout followed by a blank line (the
+ *                     puzzle itself if it was not solved).
+ * RESULT_FORMAT_LINE - each solution as one 81-character line, or "unsolvable".
+ * RESULT_FORMAT_CSV - a header line, then one comma-separated line of metrics per record.
+ * RESULT_FORMAT_JSONL - one JSON object of metrics per line.
+ */
+enum ResultFormat
+{
+  RESULT_FORMAT_DAT,
+  RESULT_FORMAT_LINE,
+  RESULT_FORMAT_CSV,
+  RESULT_FORMAT_JSONL
+};
+
+/**
+ * One solved (or unsolved) puzzle and what solving it cost.
+ *
+ * index - the number of the puzzle in its corpus, counting from 1.
+ * engine - the name of the engine that solved it.
+ * puzzle - the puzzle as given.
+ * board - the board after solving (the solution, if solved).
+ * solved - whether the engine found a solution.
+ * sample - the time and hardware counters measured around the solve; counters that were not
+ *          measured are left out (an empty CSV field, a missing JSON member).
+ */
+struct ResultRecord
+{
+  unsigned long long index;
+  const char* engine;
+  const char (*puzzle)[9];
+  const char (*board)[9];
+  bool solved;
+  PerfSample sample;
+};
+
+// The record buffers and the thread that writes them out, private to result_writer.cpp
+struct ResultSink;
+
+/**
+ * A result file open for writing.
+ *
+ * Records are formatted into a large buffer that is reused from one record to the next, and
+ * the file is only written when the buffer fills, so no record ever causes a flush of its own.
+ *
+ * format - the layout of the records.
+ * compression - the compression of the file, chosen from its name.
+ * records - the number of records written so far.
+ * file_bytes, data_bytes - the size of the file and of the records in it, set by result_close.
+ * status - SUDOKU_OK, or the first failure (once set, later writes are dropped).
+ */
+struct ResultWriter
+{
+  ResultSink* sink;
+  ResultFormat format;
+  Compression compression;
+  unsigned long long records;
+  unsigned long long file_bytes;
+  unsigned long long data_bytes;
+  SudokuStatus status;
+};
+
+
+
+
+/**
+ * Returns the layout a file name asks for: ".dat", ".csv" or ".jsonl" (".json" too), and one
+ * line per puzzle for anything else. A trailing ".gz" or ".zst" is ignored, so "out.csv.gz"
+ * is gzip-compressed CSV.
+ *
+ * @param filename - a constant character pointer to the file path.
+ *
+ * @return the format matching the file's extension.
+ */
+ResultFormat result_format_for_name(const char* filename);
+
+
+
+
+/**
+ * Returns the name of a result layout ("dat", "line", "csv" or "jsonl").
+ *
+ * @param format - the layout to name.
+ *
+ * @return a constant C-string naming the layout.
+ */
+const char* result_format_name(ResultFormat format);
+
+
+
+
+/**
+ * Creates a result file, compressed as its name asks (see corpus_create).
+ *
+ * With a background thread, each full buffer is handed to the thread to compress and write
+ * while the caller formats the next records into a second buffer; the caller only waits if
+ * it fills that buffer too before the thread is done. Without one, full buffers are written
+ * by the caller.
+ *
+ * @param filename - a constant character pointer to the output path.
+ * @param format - the layout of the records.
+ * @param background - whether to write on a thread of its own.
+ * @param writer - the writer to open; it must be closed with result_close.
+ *
+ * @return SUDOKU_OK - if the file was created, otherwise SUDOKU_ERROR_OPEN_FAILED,
+ *         SUDOKU_ERROR_UNSUPPORTED_FORMAT or SUDOKU_ERROR_WORKER_FAILED.
+ */
+SudokuStatus result_open(const char* filename, ResultFormat format, bool background,
+                         ResultWriter& writer);
+
+
+
+
+/**
+ * Formats a record into the writer's buffer, writing the buffer out if it is full.
+ *
+ * @param writer - an open writer.
+ * @param record - the record to write.
+ *
+ * @return SUDOKU_OK - if the record was accepted, otherwise the failure (possibly of an
+ *         earlier write on the background thread).
+ */
+SudokuStatus result_write(ResultWriter& writer, const ResultRecord& record);
+
+
+
+
+/**
+ * Writes out whatever is buffered, stops the background thread and closes the file.
+ *
+ * @param writer - the writer to close; it is closed even if a write fails.
+ *
+ * @return SUDOKU_OK - if every record was written, otherwise the first failure.
+ */
+SudokuStatus result_close(ResultWriter& writer);
+
+#endif
@@ -0,0 +1,527 @@
+#include "killer.h"
+#include "preflight.h"
+#include "search.h"
+
+using namespace std;
+
+/* INTERNAL HELPERS */
+
+static const unsigned short ALL_DIGITS = 0x1FF;
+
+/**
+ * Places the digit on the trail at a depth onto the board and updates the unit masks.
+ *
+ * @param state - the search state.
+ * @param depth - the decision depth whose cell and trail digit are used.
+ */
+static void place(SearchState& state, int depth)
+{
+  const int cell = state.empty_cells[depth];
+  const int row = cell / 9, column = cell % 9;
+  const unsigned short bit = 1 << (state.trail[depth] - '1');
+  const Topology& topology = *state.topology;
+
+  state.board[row][column] = state.trail[depth];
+  state.hash ^= topology.placement_keys[cell][state.trail[depth] - '1'];
+  state.unit_used[row] |= bit;
+  state.unit_used[9 + column] |= bit;
+  state.unit_used[topology.cell_units[cell][2]] |= bit;
+  for (int i = 3; i < topology.cell_unit_count[cell]; i++)
+  {
+    state.unit_used[topology.cell_units[cell][i]] |= bit;
+  }
+
+  const int cage = topology.cell_cage[cell];
+  if (cage >= 0)
+  {
+    state.cage_used[cage] |= bit;
+    state.cage_sum_left[cage] -= state.trail[depth] - '0';
+    state.cage_cells_left[cage]--;
+  }
+}
+
+/**
+ * Removes the digit placed at a depth from the board and updates the unit masks.
+ *
+ * The digit stays on the trail so the search can carry on with the digits after it.
+ *
+ * @param state - the search state.
+ * @param depth - the decision depth whose cell is cleared.
+ */
+static void unplace(SearchState& state, int depth)
+{
+  const int cell = state.empty_cells[depth];
+  const int row = cell / 9, column = cell % 9;
+  const unsigned short bit = 1 << (state.trail[depth] - '1');
+  const Topology& topology = *state.topology;
+
+  state.board[row][column] = '.';
+  state.hash ^= topology.placement_keys[cell][state.trail[depth] - '1'];
+  state.unit_used[row] &= ~bit;
+  state.unit_used[9 + column] &= ~bit;
+  state.unit_used[topology.cell_units[cell][2]] &= ~bit;
+  for (int i = 3; i < topology.cell_unit_count[cell]; i++)
+  {
+    state.unit_used[topology.cell_units[cell][i]] &= ~bit;
+  }
+
+  const int cage = topology.cell_cage[cell];
+  if (cage >= 0)
+  {
+    state.cage_used[cage] &= ~bit;
+    state.cage_sum_left[cage] += state.trail[depth] - '0';
+    state.cage_cells_left[cage]++;
+  }
+}
+
+/**
+ * Returns the digits that can still be tried at a depth, after the last one tried.
+ *
+ * @param state - the search state.
+ * @param depth - the decision depth.
+ *
+ * @return a bitmask of the remaining candidate digits (bit d - 1 for digit d).
+ */
+static unsigned short remaining_candidates(const SearchState& state, int depth)
+{
+  const int cell = state.empty_cells[depth];
+  const Topology& topology = *state.topology;
+
+  // Every topology starts with the rows and columns, so only the third (subgrid or region)
+  // unit and any extra ones such as diagonals need looking up
+  unsigned short used = state.unit_used[cell / 9] | state.unit_used[9 + cell % 9] |
+                        state.unit_used[topology.cell_units[cell][2]];
+  for (int i = 3; i < topology.cell_unit_count[cell]; i++)
+  {
+    used |= state.unit_used[topology.cell_units[cell][i]];
+  }
+
+  // A killer cage only allows the digits of the sums that can still be made
+  unsigned short allowed = ALL_DIGITS;
+  const int cage = topology.cell_cage[cell];
+  if (cage >= 0)
+  {
+    allowed = cage_digits(state.cage_cells_left[cage], state.cage_sum_left[cage],
+                          state.cage_used[cage]);
+  }
+
+  // Digits up to and including the last one tried have already been explored
+  const unsigned short tried = (1 << (state.trail[depth] - '0')) - 1;
+  return allowed & ~used & ~tried;
+}
+
+// Subtrees with fewer empty cells than this are cheaper to search again than to look up:
+// repeats are rarer near the leaves, and each lookup is a likely cache miss
+static const int MIN_CACHED_CELLS = 30;
+
+/**
+ * Counts the solutions below the current depth of a search, using a transposition table.
+ *
+ * @param state - the search state, with decisions up to state.depth filled in.
+ * @param limit - the most solutions to count, or 0 for all of them.
+ * @param table - the transposition table, or NULL.
+ * @param salt - a hash of the puzzle's empty cells and topology, mixed into every key.
+ *
+ * @return the number of solutions, which is only exact if it is below the limit.
+ */
+static long long count_from(SearchState& state, long long limit, TranspositionTable* table,
+                            unsigned long long salt)
+{
+  const int depth = state.depth;
+  if (depth == state.empty_count)
+  {
+    return 1;
+  }
+
+  // A cell with no candidates is a dead end, and cheaper to find than any lookup
+  state.trail[depth] = '0';
+  unsigned short candidates = remaining_candidates(state, depth);
+  if (!candidates)
+  {
+    return 0;
+  }
+
+  // The unit masks and the depth fix everything the subtree can do
+  unsigned long long key = 0;
+  long long count = 0;
+  const bool cached = table && state.empty_count - depth >= MIN_CACHED_CELLS;
+  if (cached)
+  {
+    key = (state.hash ^ salt) + (unsigned long long) (depth + 1) * 0x9E3779B97F4A7C15ULL;
+    key += !key;
+    if (transposition_probe(*table, key, count))
+    {
+      return count;
+    }
+  }
+
+  const long long nodes_before = state.nodes;
+  for (; candidates; candidates = remaining_candidates(state, depth))
+  {
+    state.trail[depth] = '1' + __builtin_ctz(candidates);
+    place(state, depth);
+    state.nodes++;
+    state.depth++;
+    count += count_from(state, limit ? limit - count : 0, table, salt);
+    state.depth--;
+    unplace(state, depth);
+
+    // As in search_run, stepping back from a completed board is not a backtrack
+    state.backtracks += depth + 1 < state.empty_count;
+    if (limit && count >= limit)
+    {
+      // A count cut short by the limit is not the subtree's real count, so it is not stored
+      state.trail[depth] = '0';
+      return count;
+    }
+  }
+  state.trail[depth] = '0';
+
+  if (cached)
+  {
+    transposition_store(*table, key, count, state.nodes - nodes_before);
+  }
+  return count;
+}
+
+/**
+ * Collects every valid assignment of the decisions up to a target depth.
+ *
+ * @param state - the search state, with decisions up to state.depth filled in.
+ * @param target - the depth at which to stop and record a sub-search.
+ * @param parts - the vector the sub-searches are appended to.
+ */
+static void split_from(SearchState& state, int target, vector<SearchState>& parts)
+{
+  if (state.depth == target)
+  {
+    parts.push_back(state);
+    SearchState& part = parts.back();
+    part.base_depth = target;
+    if (target < part.empty_count)
+    {
+      part.trail[target] = '0';
+    }
+    return;
+  }
+
+  const int depth = state.depth;
+  state.trail[depth] = '0';
+  unsigned short candidates = remaining_candidates(state, depth);
+  while (candidates)
+  {
+    state.trail[depth] = '1' + __builtin_ctz(candidates);
+    candidates &= candidates - 1;
+
+    place(state, depth);
+    state.depth++;
+    split_from(state, target, parts);
+    state.depth--;
+    unplace(state, depth);
+  }
+  state.trail[depth] = '0';
+}
+
+/* RESUMABLE SEARCH */
+
+/**
+ * Prepares a search over every solution of a classic board.
+ *
+ * @param state - the search state to initialise.
+ * @param board - a 9x9 character array representing the sudoku board.
+ */
+void search_init(SearchState& state, const char board[9][9])
+{
+  search_init(state, board, classic_topology());
+}
+
+/**
+ * Prepares a search over every solution of a board under a topology.
+ *
+ * @param state - the search state to initialise.
+ * @param board - a 9x9 character array representing the sudoku board.
+ * @param topology - the units of the variant; it must outlive the search.
+ */
+void search_init(SearchState& state, const char board[9][9], const Topology& topology)
+{
+  state.topology = &topology;
+  state.empty_count = 0;
+  state.depth = 0;
+  state.base_depth = 0;
+  state.at_solution = false;
+  state.nodes = 0;
+  state.backtracks = 0;
+  state.solutions = 0;
+  state.hash = 0;
+  state.trail[0] = '0';
+
+  for (int unit = 0; unit < MAX_UNITS; unit++)
+  {
+    state.unit_used[unit] = 0;
+  }
+  for (int cage = 0; cage < topology.cage_count; cage++)
+  {
+    state.cage_used[cage] = 0;
+    state.cage_sum_left[cage] = topology.cage_sum[cage];
+    state.cage_cells_left[cage] = topology.cage_size[cage];
+  }
+
+  for (int row = 0; row < 9; row++)
+  {
+    for (int column = 0; column < 9; column++)
+    {
+      const char cell = board[row][column];
+      state.board[row][column] = cell;
+      if (cell == '.')
+      {
+        state.empty_cells[state.empty_count++] = row * 9 + column;
+      }
+      else if (cell >= '1' && cell <= '9')
+      {
+        const int index = row * 9 + column;
+        state.hash ^= topology.placement_keys[index][cell - '1'];
+        for (int i = 0; i < topology.cell_unit_count[index]; i++)
+        {
+          state.unit_used[topology.cell_units[index][i]] |= 1 << (cell - '1');
+        }
+
+        // Givens that overshoot a cage's sum are caught by the preflight check below
+        const int cage = topology.cell_cage[index];
+        if (cage >= 0)
+        {
+          state.cage_used[cage] |= 1 << (cell - '1');
+          state.cage_sum_left[cage] -= cell - '0';
+          state.cage_cells_left[cage]--;
+        }
+      }
+    }
+  }
+
+  // A board with clashing givens (or any other contradiction) has no solutions at all
+  state.finished = preflight_board(board, topology).reason != PREFLIGHT_OK;
+}
+
+/**
+ * Runs the search until it finds a solution, runs out of solutions or uses up a budget.
+ *
+ * @param state - the search state to advance.
+ * @param max_nodes - the most digits to place before pausing, or 0 for no limit.
+ *
+ * @return SEARCH_FOUND, SEARCH_EXHAUSTED or SEARCH_PAUSED.
+ */
+SearchResult search_run(SearchState& state, long long max_nodes)
+{
+  if (state.finished)
+  {
+    return SEARCH_EXHAUSTED;
+  }
+
+  // Step back off the solution returned last time before looking for the next one
+  if (state.at_solution)
+  {
+    state.at_solution = false;
+    if (state.depth == state.base_depth)
+    {
+      state.finished = true;
+      return SEARCH_EXHAUSTED;
+    }
+    state.depth--;
+    unplace(state, state.depth);
+  }
+
+  const long long stop_at = state.nodes + max_nodes;
+  while (true)
+  {
+    // Every empty cell holds a digit, so the board is solved
+    if (state.depth == state.empty_count)
+    {
+      state.at_solution = true;
+      state.solutions++;
+      return SEARCH_FOUND;
+    }
+
+    // Pause between steps, where the state is complete and can be saved or resumed
+    if (max_nodes && state.nodes >= stop_at)
+    {
+      return SEARCH_PAUSED;
+    }
+
+    // Try the next valid digit in the current cell
+    const unsigned short candidates = remaining_candidates(state, state.depth);
+    if (candidates)
+    {
+      state.trail[state.depth] = '1' + __builtin_ctz(candidates);
+      place(state, state.depth);
+      state.nodes++;
+      state.depth++;
+      if (state.depth < state.empty_count)
+      {
+        state.trail[state.depth] = '0';
+      }
+      continue;
+    }
+
+    // No digit is left for this cell, so backtrack to the previous decision
+    state.trail[state.depth] = '0';
+    if (state.depth == state.base_depth)
+    {
+      state.finished = true;
+      return SEARCH_EXHAUSTED;
+    }
+    state.depth--;
+    unplace(state, state.depth);
+    state.backtracks++;
+  }
+}
+
+/**
+ * Advances the search to its next solution.
+ *
+ * @param state - the search state to advance.
+ *
+ * @return true - if another solution was found, otherwise false.
+ */
+bool search_next(SearchState& state)
+{
+  return search_run(state, 0) == SEARCH_FOUND;
+}
+
+/**
+ * Counts the solutions of a search, optionally skipping subtrees seen before.
+ *
+ * @param state - a search state fresh from search_init or search_split.
+ * @param limit - stop once this many solutions are counted, or 0 to count them all.
+ * @param table - a transposition table to use, or NULL to count without one.
+ *
+ * @return the number of solutions (at most limit, if one is given).
+ */
+long long search_count(SearchState& state, long long limit, TranspositionTable* table)
+{
+  if (state.finished || state.at_solution)
+  {
+    state.finished = true;
+    return 0;
+  }
+
+  // Boards with different empty cells or units never share entries, even with the same
+  // masks: the same hash means different things under a different topology
+  unsigned long long salt = topology_fingerprint(*state.topology);
+  for (int i = 0; i < state.empty_count; i++)
+  {
+    salt = (salt ^ state.empty_cells[i]) * 1099511628211ULL;
+  }
+
+  long long count = count_from(state, limit, table, salt);
+  if (limit && count > limit)
+  {
+    count = limit;
+  }
+  state.solutions += count;
+  state.finished = true;
+  return count;
+}
+
+/**
+ * Rebuilds a search state of a classic board from its puzzle and the digits on its trail.
+ *
+ * @param state - the search state to rebuild.
+ * @param puzzle - the board the search started from.
+ * @param trail - the digit at each decision depth, with depth + 1 entries (or depth entries if
+ *        every empty cell is filled).
+ * @param depth - the number of decisions on the trail.
+ * @param base_depth - the number of decisions that are fixed.
+ *
+ * @return true - if the trail fits the puzzle, otherwise false.
+ */
+bool search_restore(SearchState& state, const char puzzle[9][9], const char trail[], int depth,
+                    int base_depth)
+{
+  return search_restore(state, puzzle, classic_topology(), trail, depth, base_depth);
+}
+
+/**
+ * Rebuilds a search state from its puzzle, its topology and the digits on its trail.
+ *
+ * @param state - the search state to rebuild.
+ * @param puzzle - the board the search started from.
+ * @param topology - the units of the variant; it must outlive the search.
+ * @param trail - the digit at each decision depth.
+ * @param depth - the number of decisions on the trail.
+ * @param base_depth - the number of decisions that are fixed.
+ *
+ * @return true - if the trail fits the puzzle, otherwise false.
+ */
+bool search_restore(SearchState& state, const char puzzle[9][9], const Topology& topology,
+                    const char trail[], int depth, int base_depth)
+{
+  search_init(state, puzzle, topology);
+  if (depth < 0 || depth > state.empty_count || base_depth < 0 || base_depth > depth)
+  {
+    return false;
+  }
+
+  // Replay every decision, checking each digit is still a valid move
+  for (int d = 0; d < depth; d++)
+  {
+    state.trail[d] = '0';
+    const unsigned short bit = 1 << (trail[d] - '1');
+    if (trail[d] < '1' || trail[d] > '9' || !(remaining_candidates(state, d) & bit))
+    {
+      return false;
+    }
+    state.trail[d] = trail[d];
+    place(state, d);
+  }
+  if (depth < state.empty_count)
+  {
+    if (trail[depth] < '0' || trail[depth] > '9')
+    {
+      return false;
+    }
+    state.trail[depth] = trail[depth];
+  }
+  state.depth = depth;
+  state.base_depth = base_depth;
+  return true;
+}
+
+/**
+ * Recovers the puzzle a search started from.
+ *
+ * @param state - the search state.
+ * @param puzzle - a 9x9 character array that will hold the starting board.
+ */
+void search_puzzle(const SearchState& state, char puzzle[9][9])
+{
+  for (int row = 0; row < 9; row++)
+  {
+    for (int column = 0; column < 9; column++)
+    {
+      puzzle[row][column] = state.board[row][column];
+    }
+  }
+  for (int i = 0; i < state.empty_count; i++)
+  {
+    puzzle[state.empty_cells[i] / 9][state.empty_cells[i] % 9] = '.';
+  }
+}
+
+/**
+ * Splits a search into independent sub-searches by fixing its first decisions.
+ *
+ * @param root - a search state fresh from search_init.
+ * @param prefix_depth - the number of decisions to fix in each sub-search.
+ * @param parts - a vector that the sub-searches are appended to.
+ */
+void search_split(const SearchState& root, int prefix_depth, vector<SearchState>& parts)
+{
+  if (root.finished)
+  {
+    return;
+  }
+
+  const int target = root.depth + prefix_depth < root.empty_count ?
+                     root.depth + prefix_depth : root.empty_count;
+  SearchState state = root;
+  split_from(state, target, parts);
+}
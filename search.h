@@ -0,0 +1,231 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <vector>
+#include "topology.h"
+#include "transposition.h"
+
+/* RESUMABLE BACKTRACKING SEARCH */
+
+/**
+ * The complete state of a backtracking search, held in a plain struct rather than on the
+ * call stack so the search can be paused after any solution and resumed later.
+ *
+ * The search visits cells and digits in exactly the same order as solve_board: the empty
+ * cells left to right, top to bottom, and the digits '1' to '9' in each.
+ *
+ * board - the board, with the decisions on the trail filled in.
+ * empty_cells - the cells (row * 9 + column) that were empty at the start, in search order.
+ * empty_count - the number of entries in empty_cells.
+ * trail - the digit placed at each decision depth ('0' before any digit has been tried).
+ * depth - the number of decisions currently on the trail.
+ * base_depth - decisions below this depth are fixed and never undone (non-zero for the
+ *              sub-searches produced by search_split).
+ * topology - the units of the variant being solved (classic_topology() by default).
+ * unit_used - a bitmask of the digits in each unit of the topology (bit d - 1 for digit d),
+ *             kept in step with the board.
+ * cage_used, cage_sum_left, cage_cells_left - for each killer cage of the topology, the
+ *             digits in it, what its empty cells must still add up to and how many there are,
+ *             kept in step with the board.
+ * hash - the XOR of the topology's placement_keys of every digit on the board: a Zobrist
+ *        hash of unit_used and cage_used, kept in step with the board.
+ * at_solution - whether the board currently holds a solution that has been returned.
+ * finished - whether every solution has been produced.
+ * nodes - the number of digits placed so far.
+ * backtracks - the number of placed digits removed again, counted as in solve_board(board, count).
+ * solutions - the number of solutions produced so far.
+ */
+struct SearchState
+{
+  char board[9][9];
+  unsigned char empty_cells[81];
+  int empty_count;
+  char trail[81];
+  int depth;
+  int base_depth;
+  const Topology* topology;
+  unsigned short unit_used[MAX_UNITS];
+  unsigned short cage_used[MAX_CAGES];
+  unsigned char cage_sum_left[MAX_CAGES];
+  unsigned char cage_cells_left[MAX_CAGES];
+  unsigned long long hash;
+  bool at_solution;
+  bool finished;
+  long long nodes;
+  long long backtracks;
+  long long solutions;
+};
+
+
+
+
+/**
+ * Prepares a search over every solution of a board.
+ *
+ * The board is checked with preflight_board first; a board that is already known to be
+ * contradictory produces a search that is finished before it starts.
+ *
+ * @param state - the search state to initialise.
+ * @param board - a 9x9 character array representing the sudoku board.
+ */
+void search_init(SearchState& state, const char board[9][9]);
+
+
+
+
+/**
+ * Prepares a search over every solution of a sudoku variant.
+ *
+ * The search keeps a pointer to the topology rather than a copy, so the topology must
+ * outlive the search state and every copy of it.
+ *
+ * @param state - the search state to initialise.
+ * @param board - a 9x9 character array representing the sudoku board.
+ * @param topology - the units of the variant.
+ */
+void search_init(SearchState& state, const char board[9][9], const Topology& topology);
+
+
+
+
+/**
+ * The outcome of running a search for a limited time.
+ */
+enum SearchResult
+{
+  SEARCH_FOUND,     // a solution is in state.board
+  SEARCH_EXHAUSTED, // there are no more solutions
+  SEARCH_PAUSED     // the node budget ran out; calling again carries on exactly where it stopped
+};
+
+
+
+
+/**
+ * Runs the search until it finds a solution, runs out of solutions or uses up a budget.
+ *
+ * The search only pauses between steps, so a paused state is complete: it can be saved,
+ * copied or resumed later without losing or repeating any work.
+ *
+ * @param state - the search state to advance.
+ * @param max_nodes - the most digits to place before pausing, or 0 for no limit.
+ *
+ * @return SEARCH_FOUND, SEARCH_EXHAUSTED or SEARCH_PAUSED.
+ */
+SearchResult search_run(SearchState& state, long long max_nodes);
+
+
+
+
+/**
+ * Advances the search to its next solution.
+ *
+ * On success the solution is in state.board, and the following call continues the search
+ * from just after it. Once every solution has been produced, state.finished is set and
+ * every further call returns false.
+ *
+ * @param state - the search state to advance.
+ *
+ * @return true - if another solution was found, otherwise false.
+ */
+bool search_next(SearchState& state);
+
+
+
+
+/**
+ * Counts the solutions of a search, optionally skipping subtrees seen before.
+ *
+ * With the cells always filled in the same order, the part of the board still to be
+ * searched depends only on the depth and on which digits each unit (and cage) already
+ * holds, not on where those digits are. Different choices often lead to the same digit
+ * masks, e.g. two digits swapped between two cells that share their row, column and box
+ * unit-for-unit, and counting then repeats the same subtree. Given a table, every subtree
+ * with 30 or more empty cells left is looked up by the Zobrist hash of its masks and depth
+ * (and the puzzle's empty cells and topology, so one table serves many puzzles and variants)
+ * before it is searched, and its exact count, including 0 for an unsolvable one, is stored
+ * afterwards.
+ *
+ * The count is exact up to the limit. The node and backtrack counters advance as for
+ * search_next, except that a subtree found in the table costs nothing. The search is
+ * finished afterwards and cannot be resumed.
+ *
+ * @param state - a search state fresh from search_init or search_split.
+ * @param limit - stop once this many solutions are counted, or 0 to count them all.
+ * @param table - a transposition table to use, or NULL to count without one.
+ *
+ * @return the number of solutions (at most limit, if one is given).
+ */
+long long search_count(SearchState& state, long long limit, TranspositionTable* table);
+
+
+
+
+/**
+ * Rebuilds a search state from its puzzle and the digits on its trail.
+ *
+ * Each digit on the trail is replayed onto the puzzle, so a trail that does not fit the
+ * puzzle is rejected rather than producing a corrupt search. The counters and the
+ * at_solution flag are reset, and finished is set only if the puzzle fails its preflight
+ * check; a caller restoring a saved search should restore them.
+ *
+ * @param state - the search state to rebuild.
+ * @param puzzle - the board the search started from.
+ * @param trail - the digit at each decision depth, with depth + 1 entries (or depth entries if
+ *        every empty cell is filled).
+ * @param depth - the number of decisions on the trail.
+ * @param base_depth - the number of decisions that are fixed.
+ *
+ * @return true - if the trail fits the puzzle, otherwise false.
+ */
+bool search_restore(SearchState& state, const char puzzle[9][9], const char trail[], int depth,
+                    int base_depth);
+
+
+
+
+/**
+ * Rebuilds a search state of a sudoku variant from its puzzle and its trail.
+ *
+ * This is search_restore for a search that was started with a topology.
+ *
+ * @param state - the search state to rebuild.
+ * @param puzzle - the board the search started from.
+ * @param topology - the units of the variant; it must outlive the search.
+ * @param trail - the digit at each decision depth, as for search_restore.
+ * @param depth - the number of decisions on the trail.
+ * @param base_depth - the number of decisions that are fixed.
+ *
+ * @return true - if the trail fits the puzzle, otherwise false.
+ */
+bool search_restore(SearchState& state, const char puzzle[9][9], const Topology& topology,
+                    const char trail[], int depth, int base_depth);
+
+
+
+
+/**
+ * Recovers the puzzle a search started from (its board with every decision removed).
+ *
+ * @param state - the search state.
+ * @param puzzle - a 9x9 character array that will hold the starting board.
+ */
+void search_puzzle(const SearchState& state, char puzzle[9][9]);
+
+
+
+
+/**
+ * Splits a search into independent sub-searches by fixing its first decisions.
+ *
+ * Every valid assignment of the next prefix_depth empty cells becomes one sub-search, in
+ * search order. Together the sub-searches produce exactly the solutions of the original,
+ * each once. If fewer than prefix_depth cells are empty, all of them are fixed.
+ *
+ * @param root - a search state fresh from search_init.
+ * @param prefix_depth - the number of decisions to fix in each sub-search.
+ * @param parts - a vector that the sub-searches are appended to.
+ */
+void search_split(const SearchState& root, int prefix_depth, std::vector<SearchState>& parts);
+
+#endif
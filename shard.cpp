@@ -0,0 +1,539 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "shard.h"
+
+using namespace std;
+
+/* INTERNAL HELPERS */
+
+enum MessageType
+{
+  MESSAGE_SOLUTION, // one solution found in a shard
+  MESSAGE_DONE      // a shard is finished, with its counters
+};
+
+/**
+ * A fixed-size record sent from a worker to the coordinator. It is smaller than PIPE_BUF,
+ * so every write arrives whole.
+ */
+struct WorkerMessage
+{
+  int type;
+  int shard;
+  long long solutions;
+  long long nodes;
+  long long backtracks;
+  double seconds;
+  double cpu_seconds;
+  char board[81];
+};
+
+/**
+ * The coordinator's view of one worker process.
+ */
+struct Worker
+{
+  pid_t pid;
+  int task_fd;   // the coordinator writes shard indices here
+  int result_fd; // and reads WorkerMessages from here
+  int shard;     // the shard being searched, or -1 if idle
+  bool alive;
+};
+
+/**
+ * Returns the current monotonic wall-clock time in seconds.
+ */
+static double now_seconds()
+{
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Returns the CPU time used by the calling process in seconds.
+ */
+static double cpu_seconds()
+{
+  timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Reads exactly length bytes, retrying after interruptions.
+ *
+ * @return true - if every byte was read, otherwise false (end of file or error).
+ */
+static bool read_full(int fd, void* data, size_t length)
+{
+  char* bytes = (char*) data;
+  while (length)
+  {
+    const ssize_t got = read(fd, bytes, length);
+    if (got <= 0)
+    {
+      if (got < 0 && errno == EINTR)
+      {
+        continue;
+      }
+      return false;
+    }
+    bytes += got;
+    length -= got;
+  }
+  return true;
+}
+
+/**
+ * Writes exactly length bytes, retrying after interruptions.
+ *
+ * @return true - if every byte was written, otherwise false (EPIPE if the reader has gone).
+ */
+static bool write_full(int fd, const void* data, size_t length)
+{
+  const char* bytes = (const char*) data;
+  while (length)
+  {
+    const ssize_t put = write(fd, bytes, length);
+    if (put <= 0)
+    {
+      if (put < 0 && errno == EINTR)
+      {
+        continue;
+      }
+      return false;
+    }
+    bytes += put;
+    length -= put;
+  }
+  return true;
+}
+
+/**
+ * The body of a worker process: searches each shard it is sent until it is sent -1.
+ */
+static void worker_main(const char board[9][9], const Topology& topology,
+                        const vector<ShardDescriptor>& shards, int task_fd, int result_fd,
+                        long long keep_solutions)
+{
+  int index;
+  while (read_full(task_fd, &index, sizeof(index)) && index >= 0 && index < (int) shards.size())
+  {
+    const double start = now_seconds();
+    const double cpu_start = cpu_seconds();
+    WorkerMessage message;
+    memset(&message, 0, sizeof(message));
+    message.shard = index;
+
+    SearchState state;
+    if (shard_state(board, topology, shards[index], state))
+    {
+      while (search_next(state))
+      {
+        if (state.solutions <= keep_solutions)
+        {
+          message.type = MESSAGE_SOLUTION;
+          memcpy(message.board, state.board, 81);
+          if (!write_full(result_fd, &message, sizeof(message)))
+          {
+            _exit(1);
+          }
+        }
+      }
+      message.solutions = state.solutions;
+      message.nodes = state.nodes;
+      message.backtracks = state.backtracks;
+    }
+
+    message.type = MESSAGE_DONE;
+    message.seconds = now_seconds() - start;
+    message.cpu_seconds = cpu_seconds() - cpu_start;
+    if (!write_full(result_fd, &message, sizeof(message)))
+    {
+      _exit(1);
+    }
+  }
+  _exit(0);
+}
+
+/**
+ * Sends the next pending shard to an idle worker, if there is one, counting the attempt.
+ */
+static void assign_shard(Worker& worker, deque<int>& pending, vector<int>& attempts)
+{
+  if (!worker.alive || worker.shard >= 0 || pending.empty())
+  {
+    return;
+  }
+  const int shard = pending.front();
+  if (!write_full(worker.task_fd, &shard, sizeof(shard)))
+  {
+    // EPIPE: the worker has exited, so its pipe has no reader
+    worker.alive = false;
+    return;
+  }
+  pending.pop_front();
+  worker.shard = shard;
+  attempts[shard]++;
+}
+
+/**
+ * Blocks SIGPIPE in the calling thread, so that writing to the pipe of a dead worker fails
+ * with EPIPE instead of killing the process. Only this thread's mask changes; the signal's
+ * disposition, which every thread shares, is left alone.
+ *
+ * @param previous - set to the thread's signal mask before the call.
+ *
+ * @return true - if a SIGPIPE was already pending, which must then be left for its owner.
+ */
+static bool block_sigpipe(sigset_t& previous)
+{
+  sigset_t pipe_set, pending;
+  sigemptyset(&pipe_set);
+  sigaddset(&pipe_set, SIGPIPE);
+  sigpending(&pending);
+  const bool was_pending = sigismember(&pending, SIGPIPE);
+  pthread_sigmask(SIG_BLOCK, &pipe_set, &previous);
+  return was_pending;
+}
+
+/**
+ * Discards any SIGPIPE raised while it was blocked, then restores the thread's signal mask.
+ *
+ * @param previous - the mask saved by block_sigpipe.
+ * @param was_pending - what block_sigpipe returned.
+ */
+static void restore_sigpipe(const sigset_t& previous, bool was_pending)
+{
+  if (!was_pending)
+  {
+    sigset_t pipe_set;
+    sigemptyset(&pipe_set);
+    sigaddset(&pipe_set, SIGPIPE);
+    const timespec no_wait = { 0, 0 };
+    while (sigtimedwait(&pipe_set, NULL, &no_wait) == SIGPIPE)
+    {
+    }
+  }
+  pthread_sigmask(SIG_SETMASK, &previous, NULL);
+}
+
+/* SHARDED SEARCH */
+
+/**
+ * Splits the search of a classic board into shards by enumerating its first decisions.
+ *
+ * @param board - a 9x9 character array representing the sudoku board.
+ * @param prefix_depth - the number of decisions to fix in each shard.
+ * @param shards - a vector that the shard descriptors are appended to.
+ */
+void shard_plan(const char board[9][9], int prefix_depth, vector<ShardDescriptor>& shards)
+{
+  shard_plan(board, classic_topology(), prefix_depth, shards);
+}
+
+/**
+ * Splits the search of a board of a sudoku variant into shards.
+ *
+ * @param board - a 9x9 character array representing the sudoku board.
+ * @param topology - the units of the variant.
+ * @param prefix_depth - the number of decisions to fix in each shard.
+ * @param shards - a vector that the shard descriptors are appended to.
+ */
+void shard_plan(const char board[9][9], const Topology& topology, int prefix_depth,
+                vector<ShardDescriptor>& shards)
+{
+  SearchState root;
+  search_init(root, board, topology);
+
+  vector<SearchState> parts;
+  search_split(root, prefix_depth, parts);
+
+  for (size_t i = 0; i < parts.size(); i++)
+  {
+    ShardDescriptor shard;
+    shard.length = parts[i].base_depth;
+    memcpy(shard.prefix, parts[i].trail, shard.length);
+    shards.push_back(shard);
+  }
+}
+
+/**
+ * Prepares the search state for one shard of a classic board.
+ *
+ * @param board - the board the shards were planned from.
+ * @param shard - the shard to search.
+ * @param state - the search state to set up.
+ *
+ * @return true - if the shard fits the board, otherwise false.
+ */
+bool shard_state(const char board[9][9], const ShardDescriptor& shard, SearchState& state)
+{
+  return shard_state(board, classic_topology(), shard, state);
+}
+
+/**
+ * Prepares the search state for one shard of a board of a sudoku variant.
+ *
+ * @param board - the board the shards were planned from.
+ * @param topology - the units the shards were planned with; it must outlive the search.
+ * @param shard - the shard to search.
+ * @param state - the search state to set up.
+ *
+ * @return true - if the shard fits the board, otherwise false.
+ */
+bool shard_state(const char board[9][9], const Topology& topology, const ShardDescriptor& shard,
+                 SearchState& state)
+{
+  if (shard.length < 0 || shard.length > 81)
+  {
+    return false;
+  }
+
+  // The search starts with no digit tried yet just after the prefix
+  char trail[82];
+  memcpy(trail, shard.prefix, shard.length);
+  trail[shard.length] = '0';
+
+  return search_restore(state, board, topology, trail, shard.length, shard.length);
+}
+
+/**
+ * Searches every shard of a classic board in a pool of forked worker processes.
+ *
+ * @param board - a 9x9 character array representing the sudoku board.
+ * @param prefix_depth - the number of decisions to fix in each shard.
+ * @param workers - the number of worker processes (at least 1).
+ * @param keep_solutions - the most solutions to collect in the report (all are counted).
+ * @param report - filled in with the merged results and the per-shard outcomes.
+ *
+ * @return SUDOKU_OK - if the workers could be started, otherwise SUDOKU_ERROR_WORKER_FAILED.
+ */
+SudokuStatus run_sharded_search(const char board[9][9], int prefix_depth, int workers,
+                                long long keep_solutions, ShardReport& report)
+{
+  return run_sharded_search(board, classic_topology(), prefix_depth, workers, keep_solutions,
+                            report);
+}
+
+/**
+ * Searches every shard of a board of a sudoku variant in a pool of forked worker processes.
+ *
+ * @param board - a 9x9 character array representing the sudoku board.
+ * @param topology - the units of the variant.
+ * @param prefix_depth - the number of decisions to fix in each shard.
+ * @param workers - the number of worker processes (at least 1).
+ * @param keep_solutions - the most solutions to collect in the report (all are counted).
+ * @param report - filled in with the merged results and the per-shard outcomes.
+ *
+ * @return SUDOKU_OK - if the workers could be started, otherwise SUDOKU_ERROR_WORKER_FAILED.
+ */
+SudokuStatus run_sharded_search(const char board[9][9], const Topology& topology, int prefix_depth,
+                                int workers, long long keep_solutions, ShardReport& report)
+{
+  const double start = now_seconds();
+  report.shards.clear();
+  report.worker_seconds.assign(workers > 0 ? workers : 1, 0.0);
+  report.solutions.clear();
+  report.solution_count = report.nodes = report.backtracks = 0;
+  report.failed_shards = 0;
+
+  vector<ShardDescriptor> shards;
+  shard_plan(board, topology, prefix_depth, shards);
+
+  // A dead worker must not take the coordinator with it when a shard is sent to it
+  sigset_t previous_mask;
+  const bool sigpipe_pending = block_sigpipe(previous_mask);
+
+  vector<Worker> pool;
+  for (int w = 0; w < (int) report.worker_seconds.size(); w++)
+  {
+    int task[2], result[2];
+    if (pipe(task) != 0)
+    {
+      break;
+    }
+    if (pipe(result) != 0)
+    {
+      close(task[0]);
+      close(task[1]);
+      break;
+    }
+
+    // Only safe because the caller has no other threads (see shard.h): the child goes on
+    // to allocate, which could block for ever on a lock held by a thread that was not copied
+    const pid_t pid = fork();
+    if (pid == 0)
+    {
+      // Keep only this worker's own ends of its pipes
+      for (size_t i = 0; i < pool.size(); i++)
+      {
+        close(pool[i].task_fd);
+        close(pool[i].result_fd);
+      }
+      close(task[1]);
+      close(result[0]);
+      worker_main(board, topology, shards, task[0], result[1], keep_solutions);
+    }
+
+    close(task[0]);
+    close(result[1]);
+    if (pid < 0)
+    {
+      close(task[1]);
+      close(result[0]);
+      break;
+    }
+
+    Worker worker;
+    worker.pid = pid;
+    worker.task_fd = task[1];
+    worker.result_fd = result[0];
+    worker.shard = -1;
+    worker.alive = true;
+    pool.push_back(worker);
+  }
+
+  if (pool.empty())
+  {
+    restore_sigpipe(previous_mask, sigpipe_pending);
+    return SUDOKU_ERROR_WORKER_FAILED;
+  }
+
+  deque<int> pending;
+  for (size_t i = 0; i < shards.size(); i++)
+  {
+    pending.push_back(i);
+  }
+  vector<int> attempts(shards.size(), 0);
+  vector<vector<string> > found(shards.size());
+
+  for (size_t w = 0; w < pool.size(); w++)
+  {
+    assign_shard(pool[w], pending, attempts);
+  }
+
+  while (true)
+  {
+    vector<pollfd> waiting;
+    vector<int> owners;
+    for (size_t w = 0; w < pool.size(); w++)
+    {
+      if (pool[w].alive && pool[w].shard >= 0)
+      {
+        pollfd entry = { pool[w].result_fd, POLLIN, 0 };
+        waiting.push_back(entry);
+        owners.push_back(w);
+      }
+    }
+    if (waiting.empty())
+    {
+      break;
+    }
+    if (poll(&waiting[0], waiting.size(), -1) < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      break;
+    }
+
+    for (size_t i = 0; i < waiting.size(); i++)
+    {
+      if (!waiting[i].revents)
+      {
+        continue;
+      }
+      Worker& worker = pool[owners[i]];
+      WorkerMessage message;
+
+      if (!read_full(worker.result_fd, &message, sizeof(message)))
+      {
+        // The worker died: throw away its partial shard and give the shard one more try
+        worker.alive = false;
+        const int shard = worker.shard;
+        worker.shard = -1;
+        found[shard].clear();
+        if (attempts[shard] < 2)
+        {
+          pending.push_front(shard);
+        }
+        else
+        {
+          report.failed_shards++;
+        }
+        continue;
+      }
+
+      if (message.type == MESSAGE_SOLUTION)
+      {
+        found[message.shard].push_back(string(message.board, 81));
+        continue;
+      }
+
+      ShardOutcome outcome;
+      outcome.shard = message.shard;
+      outcome.worker = owners[i];
+      outcome.attempts = attempts[message.shard];
+      outcome.solutions = message.solutions;
+      outcome.nodes = message.nodes;
+      outcome.backtracks = message.backtracks;
+      outcome.seconds = message.seconds;
+      outcome.cpu_seconds = message.cpu_seconds;
+      report.shards.push_back(outcome);
+      report.worker_seconds[owners[i]] += message.seconds;
+      worker.shard = -1;
+    }
+
+    // Hand out more work to the workers that are now idle
+    for (size_t w = 0; w < pool.size(); w++)
+    {
+      assign_shard(pool[w], pending, attempts);
+    }
+  }
+
+  // Any shards still pending had no live worker left to run them
+  report.failed_shards += pending.size();
+
+  // Stop the workers and collect them
+  for (size_t w = 0; w < pool.size(); w++)
+  {
+    const int stop = -1;
+    if (pool[w].alive)
+    {
+      write_full(pool[w].task_fd, &stop, sizeof(stop));
+    }
+    close(pool[w].task_fd);
+    close(pool[w].result_fd);
+    waitpid(pool[w].pid, NULL, 0);
+  }
+  restore_sigpipe(previous_mask, sigpipe_pending);
+
+  // Merge the results in plan order so the report does not depend on scheduling
+  sort(report.shards.begin(), report.shards.end(),
+       [](const ShardOutcome& a, const ShardOutcome& b) { return a.shard < b.shard; });
+  for (size_t i = 0; i < report.shards.size(); i++)
+  {
+    const ShardOutcome& outcome = report.shards[i];
+    report.solution_count += outcome.solutions;
+    report.nodes += outcome.nodes;
+    report.backtracks += outcome.backtracks;
+    const vector<string>& solutions = found[outcome.shard];
+    for (size_t s = 0; s < solutions.size() && (long long) report.solutions.size() < keep_solutions; s++)
+    {
+      report.solutions.push_back(solutions[s]);
+    }
+  }
+  report.seconds = now_seconds() - start;
+  return SUDOKU_OK;
+}
@@ -0,0 +1,190 @@
+#ifndef SHARD_H
+#define SHARD_H
+
+#include <string>
+#include <vector>
+#include "sudoku.h"
+#include "search.h"
+
+/* MULTI-PROCESS SHARDED SEARCH */
+
+/**
+ * One independent piece of a search: the digits of its first few decisions.
+ *
+ * Together with the puzzle, a descriptor is all a worker needs to run its part of the
+ * search, so descriptors can be handed to other processes (or saved) as they are.
+ *
+ * length - the number of fixed decisions.
+ * prefix - the digit of each fixed decision, in search order.
+ */
+struct ShardDescriptor
+{
+  int length;
+  char prefix[81];
+};
+
+
+
+
+/**
+ * The result of searching one shard.
+ *
+ * shard - the index of the shard in the plan.
+ * worker - the worker process that completed it.
+ * attempts - how many times it was started (more than 1 if a worker died on it).
+ * solutions, nodes, backtracks - the search counters for the shard alone.
+ * seconds - the wall-clock time the worker spent on it.
+ * cpu_seconds - the CPU time the worker spent on it, which is what the shard really cost
+ *               when there are more workers than cores.
+ */
+struct ShardOutcome
+{
+  int shard;
+  int worker;
+  int attempts;
+  long long solutions;
+  long long nodes;
+  long long backtracks;
+  double seconds;
+  double cpu_seconds;
+};
+
+
+
+
+/**
+ * The merged results of a sharded search.
+ *
+ * shards - the outcome of every completed shard, in plan order.
+ * worker_seconds - the total time each worker spent searching.
+ * solutions - up to the requested number of solutions, each as an 81-character string.
+ * solution_count, nodes, backtracks - the counters summed over every shard.
+ * failed_shards - the number of shards that could not be completed, even after a retry;
+ *                 if non-zero the counts are incomplete.
+ * seconds - the wall-clock time of the whole run.
+ */
+struct ShardReport
+{
+  std::vector<ShardOutcome> shards;
+  std::vector<double> worker_seconds;
+  std::vector<std::string> solutions;
+  long long solution_count;
+  long long nodes;
+  long long backtracks;
+  int failed_shards;
+  double seconds;
+};
+
+
+
+
+/**
+ * Splits the search of a board into shards by enumerating its first decisions.
+ *
+ * Every valid assignment of the first prefix_depth empty cells becomes one shard (fewer
+ * decisions are fixed if the board has fewer empty cells). The shards cover the whole
+ * search tree without overlapping.
+ *
+ * @param board - a 9x9 character array representing the sudoku board.
+ * @param prefix_depth - the number of decisions to fix in each shard.
+ * @param shards - a vector that the shard descriptors are appended to.
+ */
+void shard_plan(const char board[9][9], int prefix_depth, std::vector<ShardDescriptor>& shards);
+
+
+
+
+/**
+ * Splits the search of a board of a sudoku variant into shards.
+ *
+ * @param board - a 9x9 character array representing the sudoku board.
+ * @param topology - the units of the variant.
+ * @param prefix_depth - the number of decisions to fix in each shard.
+ * @param shards - a vector that the shard descriptors are appended to.
+ */
+void shard_plan(const char board[9][9], const Topology& topology, int prefix_depth,
+                std::vector<ShardDescriptor>& shards);
+
+
+
+
+/**
+ * Prepares the search state for one shard.
+ *
+ * @param board - the board the shards were planned from.
+ * @param shard - the shard to search.
+ * @param state - the search state to set up.
+ *
+ * @return true - if the shard fits the board, otherwise false.
+ */
+bool shard_state(const char board[9][9], const ShardDescriptor& shard, SearchState& state);
+
+
+
+
+/**
+ * Prepares the search state for one shard of a board of a sudoku variant.
+ *
+ * @param board - the board the shards were planned from.
+ * @param topology - the units the shards were planned with; it must outlive the search.
+ * @param shard - the shard to search.
+ * @param state - the search state to set up.
+ *
+ * @return true - if the shard fits the board, otherwise false.
+ */
+bool shard_state(const char board[9][9], const Topology& topology, const ShardDescriptor& shard,
+                 SearchState& state);
+
+
+
+
+/**
+ * Searches every shard of a board in a pool of forked worker processes and merges the results.
+ *
+ * Each worker is a separate process with its own memory. Shards are handed out one at a
+ * time over pipes, so faster workers take more of them. If a worker dies, the shard it was
+ * working on is discarded and given to another worker once; the other workers carry on.
+ *
+ * SIGPIPE is blocked in the calling thread while the workers run, so a write to a dead
+ * worker fails instead of killing the process; the signal's handler is never touched, and
+ * other threads are not affected.
+ *
+ * The workers are forked from inside this call and then allocate memory as they search, so
+ * it must be called from a single-threaded process: a lock that another thread held at the
+ * moment of the fork (in the allocator, in a stream, or in the host's own code) is never
+ * released in the child, which would then hang. Call it before starting any threads (or
+ * after joining them), or from a helper process of its own.
+ *
+ * @param board - a 9x9 character array representing the sudoku board.
+ * @param prefix_depth - the number of decisions to fix in each shard.
+ * @param workers - the number of worker processes (at least 1).
+ * @param keep_solutions - the most solutions to collect in the report (all are counted).
+ * @param report - filled in with the merged results and the per-shard outcomes.
+ *
+ * @return SUDOKU_OK - if the workers could be started, otherwise SUDOKU_ERROR_WORKER_FAILED.
+ */
+SudokuStatus run_sharded_search(const char board[9][9], int prefix_depth, int workers,
+                                long long keep_solutions, ShardReport& report);
+
+
+
+
+/**
+ * Searches every shard of a board of a sudoku variant in a pool of forked worker processes.
+ *
+ * The workers are forked after the topology is built, so each inherits its own copy. As
+ * with the classic version, the calling process must be single-threaded.
+ *
+ * @param board - a 9x9 character array representing the sudoku board.
+ * @param topology - the units of the variant.
+ * @param prefix_depth - the number of decisions to fix in each shard.
+ * @param workers - the number of worker processes (at least 1).
+ * @param keep_solutions - the most solutions to collect in the report (all are counted).
+ * @param report - filled in with the merged results and the per-shard outcomes.
+ *
+ * @return SUDOKU_OK - if the workers could be started, otherwise SUDOKU_ERROR_WORKER_FAILED.
+ */
+SudokuStatus run_sharded_search(const char board[9][9], const Topology& topology, int prefix_depth,
+                                int workers, long long keep_solutions, ShardReport& report);
+
+#endif
@@ -0,0 +1,606 @@
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <new>
+#include <signal.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include "search.h"
+#include "shm_ring.h"
+
+using namespace std;
+
+/* INTERNAL HELPERS */
+
+static const char RING_MAGIC[8] = { 'S', 'D', 'K', 'R', 'I', 'N', 'G', 1 };
+static const unsigned int RING_VERSION = 1;
+
+// How many times a side checks for work before it goes to sleep, on a multiprocessor
+static const int SPIN_LIMIT = 4000;
+
+// How long a client sleeps at a time, so that it notices if the solver has gone away or died
+static const long COLLECT_SLEEP_NS = 50000000;
+
+enum SlotState
+{
+  SLOT_WAITING = 1,  // the request is queued or being solved
+  SLOT_SLEEPING = 2, // as SLOT_WAITING, and the client is asleep on the state
+  SLOT_ANSWERED = 3  // the reply is in the slot
+};
+
+/**
+ * The segment header, followed directly by the slots.
+ *
+ * The two queue positions and the solver wake-up word are each on a cache line of their
+ * own, so clients claiming slots and solvers taking them do not slow each other down.
+ *
+ * enqueue_position - the next request number a client will claim.
+ * dequeue_position - the next request number a solver will take.
+ * requests - bumped after every request (and on stop); solvers sleep on it.
+ * sleeping_solvers - the number of solver threads asleep, or about to be.
+ * active_solvers - the number of solver threads still running.
+ * stopped - set once the ring has been stopped.
+ * server_pid - the process that created the ring, or last started serving it; if it dies
+ *              without stopping the ring (e.g. killed with SIGKILL), clients stop waiting.
+ */
+struct RingHeader
+{
+  char magic[8];
+  unsigned int version;
+  unsigned int slot_size;
+  unsigned long long capacity;
+  atomic<unsigned int> stopped;
+  atomic<unsigned int> active_solvers;
+  atomic<int> server_pid;
+  alignas(64) atomic<unsigned long long> enqueue_position;
+  alignas(64) atomic<unsigned long long> dequeue_position;
+  alignas(64) atomic<unsigned int> requests;
+  atomic<unsigned int> sleeping_solvers;
+};
+
+/**
+ * One slot of the ring, two cache lines long so neighbouring slots never share a line.
+ */
+struct alignas(128) RingSlot
+{
+  atomic<unsigned long long> sequence;
+  atomic<unsigned int> state;
+  int status;
+  long long solve_ns;
+  bool solved;
+  char board[81];
+};
+
+static_assert(sizeof(RingHeader) == 256, "the ring header must stay 256 bytes");
+static_assert(sizeof(RingSlot) == 128, "a ring slot must stay 128 bytes");
+static_assert(atomic<unsigned long long>::is_always_lock_free &&
+              atomic<unsigned int>::is_always_lock_free,
+              "the ring needs address-free atomics to be shared between processes");
+
+/**
+ * Returns the header of a mapped ring.
+ */
+static RingHeader* header_of(const ShmRing& ring)
+{
+  return (RingHeader*) ring.map;
+}
+
+/**
+ * Returns the slot a request number falls in.
+ */
+static RingSlot* slot_of(const ShmRing& ring, unsigned long long position)
+{
+  return (RingSlot*) ((char*) ring.map + sizeof(RingHeader)) + (position & (ring.capacity - 1));
+}
+
+/**
+ * Returns the current monotonic wall-clock time in nanoseconds.
+ */
+static long long now_ns()
+{
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (long long) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * Tells the processor this thread is spinning.
+ */
+static void cpu_relax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#endif
+}
+
+/**
+ * Sleeps while a futex word holds a value, for at most a given time (or for ever if 0).
+ * The word is shared between processes, so the private futex operations cannot be used.
+ *
+ * @return false - if the time ran out, otherwise true.
+ */
+static bool futex_wait(atomic<unsigned int>& word, unsigned int value, long timeout_ns)
+{
+  timespec timeout = { 0, timeout_ns };
+  return syscall(SYS_futex, (unsigned int*) &word, FUTEX_WAIT, value,
+                 timeout_ns ? &timeout : NULL, NULL, 0) == 0 || errno != ETIMEDOUT;
+}
+
+/**
+ * Wakes up to count threads sleeping on a futex word.
+ */
+static void futex_wake(atomic<unsigned int>& word, int count)
+{
+  syscall(SYS_futex, (unsigned int*) &word, FUTEX_WAKE, count, NULL, NULL, 0);
+}
+
+/**
+ * Checks whether the process serving a ring still exists. A process that exists but belongs
+ * to someone else (EPERM) counts as alive.
+ */
+static bool server_alive(const RingHeader& header)
+{
+  const int pid = header.server_pid.load();
+  return pid <= 0 || kill(pid, 0) == 0 || errno != ESRCH;
+}
+
+/**
+ * Puts a leading '/' on a segment name.
+ *
+ * @return true - if the name fits the ring's buffer, otherwise false.
+ */
+static bool segment_name(const char* name, char full[256])
+{
+  const bool slash = name[0] == '/';
+  if (strlen(name) + !slash >= 256)
+  {
+    return false;
+  }
+  full[0] = '/';
+  strcpy(full + !slash, name);
+  return true;
+}
+
+/**
+ * Checks whether the slot of a request number holds a request no solver has taken yet.
+ */
+static bool request_ready(const ShmRing& ring, unsigned long long position)
+{
+  return slot_of(ring, position)->sequence.load(memory_order_acquire) == position + 1;
+}
+
+/**
+ * Solves the request in a slot and hands the reply back to its client.
+ */
+static void answer(RingSlot& slot, const Topology& topology)
+{
+  const long long start = now_ns();
+  char board[9][9];
+  slot.status = parse_board(slot.board, 81, board);
+  slot.solved = false;
+  if (slot.status == SUDOKU_OK)
+  {
+    SearchState state;
+    search_init(state, board, topology);
+    slot.solved = search_next(state);
+    if (slot.solved)
+    {
+      memcpy(slot.board, state.board, 81);
+    }
+  }
+  slot.solve_ns = now_ns() - start;
+
+  if (slot.state.exchange(SLOT_ANSWERED, memory_order_acq_rel) == SLOT_SLEEPING)
+  {
+    futex_wake(slot.state, 1);
+  }
+}
+
+/**
+ * Takes requests from the ring and answers them until the ring is stopped and empty.
+ *
+ * @return the number of requests this thread answered.
+ */
+static unsigned long long solve_requests(ShmRing& ring, const Topology& topology)
+{
+  RingHeader& header = *header_of(ring);
+  unsigned long long answered = 0;
+  int idle = 0;
+  while (true)
+  {
+    unsigned long long position = header.dequeue_position.load(memory_order_relaxed);
+    RingSlot& slot = *slot_of(ring, position);
+    const long long difference = (long long) (slot.sequence.load(memory_order_acquire) -
+                                              (position + 1));
+    if (difference == 0)
+    {
+      if (header.dequeue_position.compare_exchange_weak(position, position + 1,
+                                                        memory_order_relaxed))
+      {
+        answer(slot, topology);
+        answered++;
+        idle = 0;
+      }
+      continue;
+    }
+    if (difference > 0)
+    {
+      // Another solver took this request first
+      continue;
+    }
+
+    // Nothing is queued: stop if asked to, otherwise spin for a while, then sleep
+    if (header.stopped.load(memory_order_acquire))
+    {
+      return answered;
+    }
+    if (idle++ < ring.spin_limit)
+    {
+      cpu_relax();
+      continue;
+    }
+    header.sleeping_solvers.fetch_add(1);
+    const unsigned int requests = header.requests.load();
+    if (!request_ready(ring, header.dequeue_position.load()) && !header.stopped.load())
+    {
+      futex_wait(header.requests, requests, 0);
+    }
+    header.sleeping_solvers.fetch_sub(1);
+    idle = 0;
+  }
+}
+
+/* SHARED-MEMORY SOLVER RING */
+
+/**
+ * Creates a solver ring in a new shared-memory segment and maps it.
+ *
+ * @param name - the name of the segment.
+ * @param capacity - the number of slots, rounded up to a power of two.
+ * @param ring - the ring to fill in.
+ *
+ * @return SUDOKU_OK - if the ring was created, otherwise the code describing the failure.
+ */
+SudokuStatus shm_ring_create(const char* name, unsigned long long capacity, ShmRing& ring)
+{
+  ring.map = NULL;
+  if (!name || !capacity || capacity > (1ULL << 24) || !segment_name(name, ring.name))
+  {
+    return SUDOKU_ERROR_INVALID_ARGUMENT;
+  }
+  // With a single slot, request n + 1 would find it free while request n still held it
+  unsigned long long slots = 2;
+  while (slots < capacity)
+  {
+    slots <<= 1;
+  }
+
+  const int fd = shm_open(ring.name, O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd < 0)
+  {
+    return SUDOKU_ERROR_OPEN_FAILED;
+  }
+  const unsigned long long size = sizeof(RingHeader) + slots * sizeof(RingSlot);
+  void* map = MAP_FAILED;
+  if (ftruncate(fd, size) == 0)
+  {
+    map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  close(fd);
+  if (map == MAP_FAILED)
+  {
+    shm_unlink(ring.name);
+    return SUDOKU_ERROR_OPEN_FAILED;
+  }
+
+  // Slot n starts out free for request n; the magic goes in last, so a client attaching
+  // early never sees a half-built ring
+  RingHeader* header = new (map) RingHeader();
+  header->version = RING_VERSION;
+  header->slot_size = sizeof(RingSlot);
+  header->capacity = slots;
+  header->server_pid.store(getpid());
+  RingSlot* first = (RingSlot*) ((char*) map + sizeof(RingHeader));
+  for (unsigned long long i = 0; i < slots; i++)
+  {
+    new (first + i) RingSlot();
+    first[i].sequence.store(i, memory_order_relaxed);
+  }
+  atomic_thread_fence(memory_order_release);
+  memcpy(header->magic, RING_MAGIC, 8);
+
+  ring.map = map;
+  ring.size = size;
+  ring.capacity = slots;
+  ring.owner = true;
+  ring.spin_limit = thread::hardware_concurrency() > 1 ? SPIN_LIMIT : 0;
+  return SUDOKU_OK;
+}
+
+/**
+ * Maps an existing solver ring into this process.
+ *
+ * @param name - the name the ring was created with.
+ * @param ring - the ring to fill in.
+ *
+ * @return SUDOKU_OK - if the ring was mapped, otherwise the code describing the failure.
+ */
+SudokuStatus shm_ring_attach(const char* name, ShmRing& ring)
+{
+  ring.map = NULL;
+  if (!name || !segment_name(name, ring.name))
+  {
+    return SUDOKU_ERROR_INVALID_ARGUMENT;
+  }
+
+  const int fd = shm_open(ring.name, O_RDWR, 0);
+  if (fd < 0)
+  {
+    return SUDOKU_ERROR_OPEN_FAILED;
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0 || (unsigned long long) info.st_size < sizeof(RingHeader))
+  {
+    close(fd);
+    return SUDOKU_ERROR_INVALID_RING;
+  }
+  void* map = mmap(NULL, info.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED)
+  {
+    return SUDOKU_ERROR_OPEN_FAILED;
+  }
+
+  const RingHeader* header = (const RingHeader*) map;
+  atomic_thread_fence(memory_order_acquire);
+  if (memcmp(header->magic, RING_MAGIC, 8) != 0 || header->version != RING_VERSION ||
+      header->slot_size != sizeof(RingSlot) || !header->capacity ||
+      (header->capacity & (header->capacity - 1)) ||
+      (unsigned long long) info.st_size != sizeof(RingHeader) + header->capacity * sizeof(RingSlot))
+  {
+    munmap(map, info.st_size);
+    return SUDOKU_ERROR_INVALID_RING;
+  }
+  if (header->stopped.load() || !server_alive(*header))
+  {
+    munmap(map, info.st_size);
+    return SUDOKU_ERROR_RING_STOPPED;
+  }
+
+  ring.map = map;
+  ring.size = info.st_size;
+  ring.capacity = header->capacity;
+  ring.owner = false;
+  ring.spin_limit = thread::hardware_concurrency() > 1 ? SPIN_LIMIT : 0;
+  return SUDOKU_OK;
+}
+
+/**
+ * Unmaps a ring, and removes its segment if this process created it.
+ *
+ * @param ring - the ring to close.
+ */
+void shm_ring_close(ShmRing& ring)
+{
+  if (!ring.map)
+  {
+    return;
+  }
+  munmap(ring.map, ring.size);
+  ring.map = NULL;
+  if (ring.owner)
+  {
+    shm_unlink(ring.name); // fails harmlessly if shm_ring_remove got there first
+  }
+}
+
+/**
+ * Removes the segment of a ring by name.
+ *
+ * @param name - the name of the segment.
+ *
+ * @return true - if the segment was removed, otherwise false.
+ */
+bool shm_ring_remove(const char* name)
+{
+  char full[256];
+  return name && segment_name(name, full) && shm_unlink(full) == 0;
+}
+
+/**
+ * Puts a board into the ring for a solver to solve, without waiting.
+ *
+ * @param ring - a mapped ring.
+ * @param board - the board.
+ * @param ticket - set to the ticket to collect the reply with.
+ *
+ * @return SUDOKU_OK - if the board was queued, otherwise the code describing the failure.
+ */
+SudokuStatus shm_ring_submit(ShmRing& ring, const char board[9][9], unsigned long long& ticket)
+{
+  RingHeader& header = *header_of(ring);
+  if (header.stopped.load(memory_order_acquire))
+  {
+    return SUDOKU_ERROR_RING_STOPPED;
+  }
+
+  // Claim the next request number whose slot has been handed back
+  unsigned long long position = header.enqueue_position.load(memory_order_relaxed);
+  RingSlot* slot;
+  while (true)
+  {
+    slot = slot_of(ring, position);
+    const long long difference = (long long) (slot->sequence.load(memory_order_acquire) -
+                                              position);
+    if (difference == 0)
+    {
+      if (header.enqueue_position.compare_exchange_weak(position, position + 1,
+                                                        memory_order_relaxed))
+      {
+        break;
+      }
+    }
+    else if (difference < 0)
+    {
+      return SUDOKU_ERROR_RING_FULL;
+    }
+    else
+    {
+      position = header.enqueue_position.load(memory_order_relaxed);
+    }
+  }
+
+  memcpy(slot->board, board, 81);
+  slot->state.store(SLOT_WAITING, memory_order_relaxed);
+  slot->sequence.store(position + 1, memory_order_release);
+  ticket = position;
+
+  // Only make the system call if a solver is asleep (or about to be)
+  header.requests.fetch_add(1);
+  if (header.sleeping_solvers.load())
+  {
+    futex_wake(header.requests, 1);
+  }
+  return SUDOKU_OK;
+}
+
+/**
+ * Waits for the reply to a request and frees its slot.
+ *
+ * @param ring - a mapped ring.
+ * @param ticket - the ticket given by shm_ring_submit.
+ * @param reply - filled in with the answer.
+ */
+void shm_ring_collect(ShmRing& ring, unsigned long long ticket, ShmReply& reply)
+{
+  RingHeader& header = *header_of(ring);
+  RingSlot& slot = *slot_of(ring, ticket);
+
+  for (int spins = 0; spins < ring.spin_limit &&
+       slot.state.load(memory_order_acquire) != SLOT_ANSWERED; spins++)
+  {
+    cpu_relax();
+  }
+  bool server_died = false;
+  while (slot.state.load(memory_order_acquire) != SLOT_ANSWERED)
+  {
+    // Once every solver thread has returned, or the server has died, nobody is left to answer
+    if (((header.stopped.load() && !header.active_solvers.load()) || server_died) &&
+        slot.state.load(memory_order_acquire) != SLOT_ANSWERED)
+    {
+      reply.status = SUDOKU_ERROR_RING_STOPPED;
+      reply.solved = false;
+      memcpy(reply.board, slot.board, 81);
+      reply.solve_ns = 0;
+      return;
+    }
+    unsigned int expected = SLOT_WAITING;
+    if (slot.state.compare_exchange_strong(expected, SLOT_SLEEPING) || expected == SLOT_SLEEPING)
+    {
+      if (!futex_wait(slot.state, SLOT_SLEEPING, COLLECT_SLEEP_NS))
+      {
+        server_died = !server_alive(header);
+      }
+    }
+  }
+
+  reply.status = (SudokuStatus) slot.status;
+  reply.solved = slot.solved;
+  memcpy(reply.board, slot.board, 81);
+  reply.solve_ns = slot.solve_ns;
+  slot.sequence.store(ticket + ring.capacity, memory_order_release);
+}
+
+/**
+ * Solves a board through the ring, waiting for a free slot if need be.
+ *
+ * @param ring - a mapped ring.
+ * @param board - the board.
+ * @param reply - filled in with the answer.
+ *
+ * @return SUDOKU_OK - if the board was answered, otherwise SUDOKU_ERROR_RING_STOPPED.
+ */
+SudokuStatus shm_ring_solve(ShmRing& ring, const char board[9][9], ShmReply& reply)
+{
+  unsigned long long ticket;
+  SudokuStatus status;
+  long long check_at = now_ns() + COLLECT_SLEEP_NS;
+  while ((status = shm_ring_submit(ring, board, ticket)) == SUDOKU_ERROR_RING_FULL)
+  {
+    this_thread::yield();
+    if (now_ns() >= check_at)
+    {
+      if (!server_alive(*header_of(ring)))
+      {
+        return SUDOKU_ERROR_RING_STOPPED;
+      }
+      check_at = now_ns() + COLLECT_SLEEP_NS;
+    }
+  }
+  if (status != SUDOKU_OK)
+  {
+    return status;
+  }
+  shm_ring_collect(ring, ticket, reply);
+  return reply.status == SUDOKU_ERROR_RING_STOPPED ? SUDOKU_ERROR_RING_STOPPED : SUDOKU_OK;
+}
+
+/**
+ * Answers the requests in a ring on several threads until the ring is stopped.
+ *
+ * @param ring - a mapped ring.
+ * @param topology - the units of the variant the boards belong to.
+ * @param threads - the number of solver threads.
+ *
+ * @return the number of requests answered.
+ */
+unsigned long long shm_ring_serve(ShmRing& ring, const Topology& topology, int threads)
+{
+  if (threads < 1)
+  {
+    threads = 1;
+  }
+  RingHeader& header = *header_of(ring);
+  header.server_pid.store(getpid());
+  header.active_solvers.fetch_add(threads);
+
+  atomic<unsigned long long> answered(0);
+  auto worker = [&]()
+  {
+    answered += solve_requests(ring, topology);
+    header.active_solvers.fetch_sub(1);
+  };
+
+  vector<thread> pool;
+  for (int t = 1; t < threads; t++)
+  {
+    pool.push_back(thread(worker));
+  }
+  worker();
+  for (size_t t = 0; t < pool.size(); t++)
+  {
+    pool[t].join();
+  }
+  return answered;
+}
+
+/**
+ * Stops the solver of a ring.
+ *
+ * @param ring - a mapped ring.
+ */
+void shm_ring_stop(ShmRing& ring)
+{
+  RingHeader& header = *header_of(ring);
+  header.stopped.store(1);
+  header.requests.fetch_add(1);
+  futex_wake(header.requests, INT_MAX);
+}
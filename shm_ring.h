@@ -0,0 +1,196 @@
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+#include "sudoku.h"
+#include "topology.h"
+
+/* SHARED-MEMORY SOLVER RING */
+
+/**
+ * A solver ring mapped into this process.
+ *
+ * The ring is a POSIX shared-memory segment holding a small header and a power of two
+ * slots. Each slot carries one board: a client copies its 81 cells in, a solver thread
+ * solves them in place, and the client copies the result out, so a board crosses between
+ * processes with no encoding and no system call unless one side has to sleep.
+ *
+ * The slots form a lock-free multi-producer, multi-consumer queue. Every slot has a
+ * sequence number that says whose turn it is: a client may claim the slot for request n
+ * when its sequence is n, a solver may take it when the sequence is n + 1, and the client
+ * hands it back for request n + capacity once it has read the result. Any number of client
+ * processes and solver threads can share one ring.
+ *
+ * A side that finds nothing to do spins briefly (on machines with more than one processor)
+ * and then sleeps on a futex; the other side only makes the wake-up call when someone is
+ * actually asleep.
+ *
+ * map - the mapping of the segment.
+ * size - the size of the mapping in bytes.
+ * capacity - the number of slots.
+ * owner - whether this process created the segment (and removes it on close).
+ * spin_limit - how many times to check before sleeping (0 on a single processor).
+ * name - the name of the segment, always starting with '/'.
+ */
+struct ShmRing
+{
+  void* map;
+  unsigned long long size;
+  unsigned long long capacity;
+  bool owner;
+  int spin_limit;
+  char name[256];
+};
+
+/**
+ * The answer to one request.
+ *
+ * status - SUDOKU_OK, SUDOKU_ERROR_INVALID_CHARACTER if the request was not a board, or
+ *          SUDOKU_ERROR_RING_STOPPED if the solver stopped before answering.
+ * solved - whether the board has a solution.
+ * board - the solution, or the board as sent if there is none.
+ * solve_ns - how long the solver spent on the board, in nanoseconds, so that a client can
+ *            tell the cost of the ring itself from the cost of solving.
+ */
+struct ShmReply
+{
+  SudokuStatus status;
+  bool solved;
+  char board[9][9];
+  long long solve_ns;
+};
+
+
+
+
+/**
+ * Creates a solver ring in a new shared-memory segment and maps it.
+ *
+ * @param name - the name of the segment (a leading '/' is added if missing).
+ * @param capacity - the number of slots, rounded up to a power of two (and to at least 2);
+ *        this is the most requests that can be waiting or being solved at once.
+ * @param ring - the ring to fill in; it must be closed with shm_ring_close, which also
+ *        removes the segment.
+ *
+ * @return SUDOKU_OK - if the ring was created, otherwise SUDOKU_ERROR_INVALID_ARGUMENT or
+ *         SUDOKU_ERROR_OPEN_FAILED (for example, if a segment of that name already exists).
+ */
+SudokuStatus shm_ring_create(const char* name, unsigned long long capacity, ShmRing& ring);
+
+
+
+
+/**
+ * Maps an existing solver ring into this process.
+ *
+ * @param name - the name the ring was created with.
+ * @param ring - the ring to fill in; it must be closed with shm_ring_close.
+ *
+ * @return SUDOKU_OK - if the ring was mapped, otherwise SUDOKU_ERROR_OPEN_FAILED,
+ *         SUDOKU_ERROR_INVALID_RING or SUDOKU_ERROR_RING_STOPPED (the ring was stopped, or
+ *         the process serving it has died).
+ */
+SudokuStatus shm_ring_attach(const char* name, ShmRing& ring);
+
+
+
+
+/**
+ * Unmaps a ring, and removes its segment if this process created it.
+ *
+ * @param ring - the ring to close.
+ */
+void shm_ring_close(ShmRing& ring);
+
+
+
+
+/**
+ * Removes the segment of a ring by name, e.g. one left behind by a solver that crashed.
+ * Processes that still have the ring mapped keep using it.
+ *
+ * @param name - the name of the segment.
+ *
+ * @return true - if the segment was removed, otherwise false.
+ */
+bool shm_ring_remove(const char* name);
+
+
+
+
+/**
+ * Puts a board into the ring for a solver to solve, without waiting.
+ *
+ * @param ring - a mapped ring.
+ * @param board - the board; its 81 cells are copied into a slot as they are.
+ * @param ticket - set to the ticket to collect the reply with.
+ *
+ * @return SUDOKU_OK - if the board was queued, otherwise SUDOKU_ERROR_RING_FULL (every slot
+ *         is in use) or SUDOKU_ERROR_RING_STOPPED.
+ */
+SudokuStatus shm_ring_submit(ShmRing& ring, const char board[9][9], unsigned long long& ticket);
+
+
+
+
+/**
+ * Waits for the reply to a request and frees its slot.
+ *
+ * Every ticket must be collected exactly once, by the process that submitted it: the slot
+ * is not reused until it is, and once the ring has gone round the slot stalls every client
+ * behind it.
+ *
+ * If the ring is stopped before the request is answered, or the process serving it dies
+ * (which the client notices within 50 ms), the reply's status is SUDOKU_ERROR_RING_STOPPED.
+ *
+ * @param ring - a mapped ring.
+ * @param ticket - the ticket given by shm_ring_submit.
+ * @param reply - filled in with the answer.
+ */
+void shm_ring_collect(ShmRing& ring, unsigned long long ticket, ShmReply& reply);
+
+
+
+
+/**
+ * Solves a board through the ring: submits it, waiting for a free slot if need be, and
+ * collects the reply.
+ *
+ * @param ring - a mapped ring.
+ * @param board - the board.
+ * @param reply - filled in with the answer.
+ *
+ * @return SUDOKU_OK - if the board was answered (reply.status says how), otherwise
+ *         SUDOKU_ERROR_RING_STOPPED (including when the server dies while every slot is full).
+ */
+SudokuStatus shm_ring_solve(ShmRing& ring, const char board[9][9], ShmReply& reply);
+
+
+
+
+/**
+ * Answers the requests in a ring on several threads until the ring is stopped.
+ *
+ * Each board is checked and solved with the resumable search (the first solution in search
+ * order) under the given topology. When the ring is stopped, requests already queued are
+ * still answered.
+ *
+ * @param ring - a mapped ring.
+ * @param topology - the units of the variant the boards belong to.
+ * @param threads - the number of solver threads (at least 1, counting the calling thread).
+ *
+ * @return the number of requests answered.
+ */
+unsigned long long shm_ring_serve(ShmRing& ring, const Topology& topology, int threads);
+
+
+
+
+/**
+ * Stops the solver of a ring: its threads finish the queued requests and return, and no
+ * more requests are accepted.
+ *
+ * @param ring - a mapped ring (in any process).
+ */
+void shm_ring_stop(ShmRing& ring);
+
+#endif
@@ -0,0 +1,618 @@
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "search.h"
+#include "solution_db.h"
+
+/* INTERNAL HELPERS */
+
+static const char DB_MAGIC[8] = { 'S', 'D', 'K', 'D', 'B', 0, 0, 1 };
+static const unsigned int DB_VERSION = 1;
+
+enum SlotState
+{
+  SLOT_EMPTY = 0,
+  SLOT_READY = 2
+};
+
+/**
+ * The file header, followed directly by the slots.
+ *
+ * topology - the fingerprint of the units the records were computed under, or 0 for classic
+ *            sudoku (as in files written before variants were stored).
+ */
+struct DbHeader
+{
+  char magic[8];
+  unsigned int version;
+  unsigned int slot_size;
+  unsigned long long capacity;
+  unsigned long long count;
+  unsigned long long topology;
+  char reserved[24];
+};
+
+/**
+ * One record of the table. The puzzle and solution are stored in canonical form.
+ */
+struct DbSlot
+{
+  unsigned int state;
+  int difficulty;
+  unsigned long long hash;
+  long long solution_count;
+  long long backtracks;
+  char puzzle[81];
+  char solution[81];
+};
+
+static_assert(sizeof(DbHeader) == 64, "the database header must stay 64 bytes");
+
+/**
+ * Returns the header of a mapped database.
+ */
+static DbHeader* header_of(const SolutionDb& db)
+{
+  return (DbHeader*) db.map;
+}
+
+/**
+ * Returns the slot array of a mapped database.
+ */
+static DbSlot* slots_of(const SolutionDb& db)
+{
+  return (DbSlot*) ((char*) db.map + sizeof(DbHeader));
+}
+
+/**
+ * Renumbers the digits of a board in order of first appearance.
+ *
+ * @param board - the board to renumber.
+ * @param out - the renumbered board.
+ * @param relabel - filled in with the new label of each digit; digits that do not appear
+ *        get the remaining labels in increasing order.
+ */
+static void relabel_board(const char board[9][9], char out[9][9], char relabel[9])
+{
+  for (int d = 0; d < 9; d++)
+  {
+    relabel[d] = 0;
+  }
+  char next = '1';
+  for (int row = 0; row < 9; row++)
+  {
+    for (int column = 0; column < 9; column++)
+    {
+      const char cell = board[row][column];
+      if (cell >= '1' && cell <= '9' && !relabel[cell - '1'])
+      {
+        relabel[cell - '1'] = next++;
+      }
+    }
+  }
+  for (int d = 0; d < 9; d++)
+  {
+    if (!relabel[d])
+    {
+      relabel[d] = next++;
+    }
+  }
+  for (int row = 0; row < 9; row++)
+  {
+    for (int column = 0; column < 9; column++)
+    {
+      const char cell = board[row][column];
+      out[row][column] = (cell >= '1' && cell <= '9') ? relabel[cell - '1'] : '.';
+    }
+  }
+}
+
+/**
+ * Maps a board in canonical labels back to the labels and orientation of the original.
+ */
+static void decanonicalise(const char canonical[9][9], const char relabel[9], bool transposed,
+                           char out[9][9])
+{
+  char inverse[9];
+  for (int d = 0; d < 9; d++)
+  {
+    inverse[relabel[d] - '1'] = '1' + d;
+  }
+  for (int row = 0; row < 9; row++)
+  {
+    for (int column = 0; column < 9; column++)
+    {
+      const char cell = transposed ? canonical[column][row] : canonical[row][column];
+      out[row][column] = (cell >= '1' && cell <= '9') ? inverse[cell - '1'] : '.';
+    }
+  }
+}
+
+/**
+ * Checks whether swapping rows and columns maps every unit and cage of a topology onto a
+ * unit or cage of the same kind, so that a board and its transpose have the same solutions
+ * (transposed). Classic, diagonal and symmetric jigsaw topologies do; most jigsaws do not.
+ */
+static bool transpose_symmetric(const Topology& topology)
+{
+  for (int unit = 0; unit < topology.unit_count; unit++)
+  {
+    unsigned long long flipped[2] = { 0, 0 };
+    for (int k = 0; k < 9; k++)
+    {
+      const int cell = topology.units[unit][k];
+      const int image = (cell % 9) * 9 + cell / 9;
+      flipped[image / 64] |= 1ULL << (image % 64);
+    }
+
+    bool found = false;
+    for (int other = 0; other < topology.unit_count && !found; other++)
+    {
+      unsigned long long cells[2] = { 0, 0 };
+      for (int k = 0; k < 9; k++)
+      {
+        cells[topology.units[other][k] / 64] |= 1ULL << (topology.units[other][k] % 64);
+      }
+      found = cells[0] == flipped[0] && cells[1] == flipped[1];
+    }
+    if (!found)
+    {
+      return false;
+    }
+  }
+
+  for (int cage = 0; cage < topology.cage_count; cage++)
+  {
+    const int first = topology.cage_cells[cage][0];
+    const int image = topology.cell_cage[(first % 9) * 9 + first / 9];
+    if (image < 0 || topology.cage_sum[image] != topology.cage_sum[cage] ||
+        topology.cage_size[image] != topology.cage_size[cage])
+    {
+      return false;
+    }
+    for (int k = 0; k < topology.cage_size[cage]; k++)
+    {
+      const int cell = topology.cage_cells[cage][k];
+      if (topology.cell_cage[(cell % 9) * 9 + cell / 9] != image)
+      {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+/**
+ * Puts a board into canonical form using only the symmetries a variant allows.
+ *
+ * @param board - the board.
+ * @param transpose - whether the variant is unchanged by swapping rows and columns.
+ * @param relabel_digits - whether the digits may be renumbered (not with killer cages, whose
+ *        sums depend on the digits).
+ * @param canonical - the canonical board.
+ * @param relabel - filled in with the new label of each digit.
+ * @param transposed - set to true if the canonical board is the transposed one.
+ *
+ * @return the 64-bit hash of the canonical board.
+ */
+static unsigned long long canonicalise(const char board[9][9], bool transpose, bool relabel_digits,
+                                       char canonical[9][9], char relabel[9], bool& transposed)
+{
+  char transpose_board[9][9];
+  for (int row = 0; row < 9; row++)
+  {
+    for (int column = 0; column < 9; column++)
+    {
+      transpose_board[row][column] = board[column][row];
+    }
+  }
+
+  char plain[9][9], flipped[9][9], plain_labels[9], flipped_labels[9];
+  if (relabel_digits)
+  {
+    relabel_board(board, plain, plain_labels);
+    relabel_board(transpose_board, flipped, flipped_labels);
+  }
+  else
+  {
+    for (int d = 0; d < 9; d++)
+    {
+      plain_labels[d] = flipped_labels[d] = '1' + d;
+    }
+    for (int i = 0; i < 81; i++)
+    {
+      const char cell = board[i / 9][i % 9], flipped_cell = transpose_board[i / 9][i % 9];
+      plain[i / 9][i % 9] = (cell >= '1' && cell <= '9') ? cell : '.';
+      flipped[i / 9][i % 9] = (flipped_cell >= '1' && flipped_cell <= '9') ? flipped_cell : '.';
+    }
+  }
+
+  transposed = transpose && memcmp(flipped, plain, 81) < 0;
+  memcpy(canonical, transposed ? flipped : plain, 81);
+  memcpy(relabel, transposed ? flipped_labels : plain_labels, 9);
+
+  // 64-bit FNV-1a
+  unsigned long long hash = 14695981039346656037ULL;
+  for (int i = 0; i < 81; i++)
+  {
+    hash = (hash ^ (unsigned char) canonical[i / 9][i % 9]) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+/**
+ * Finds the slot holding a canonical puzzle, or the empty slot where it would go.
+ *
+ * @return the slot index, or -1 if the table is full without the puzzle in it.
+ */
+static long long find_slot(const SolutionDb& db, unsigned long long hash, const char canonical[9][9])
+{
+  const unsigned long long capacity = header_of(db)->capacity;
+  DbSlot* slots = slots_of(db);
+
+  for (unsigned long long probe = 0; probe < capacity; probe++)
+  {
+    const unsigned long long index = (hash + probe) & (capacity - 1);
+    const unsigned int state = __atomic_load_n(&slots[index].state, __ATOMIC_ACQUIRE);
+    if (state == SLOT_EMPTY)
+    {
+      return index;
+    }
+    if (slots[index].hash == hash && !memcmp(slots[index].puzzle, canonical, 81))
+    {
+      return index;
+    }
+  }
+  return -1;
+}
+
+/* PERSISTENT SOLUTION DATABASE */
+
+/**
+ * Puts a board into canonical form.
+ *
+ * @param board - a 9x9 character array representing the sudoku board.
+ * @param canonical - a 9x9 character array that will hold the canonical board.
+ * @param relabel - filled in with the new label of each digit ('1'-'9' at index d - 1).
+ * @param transposed - set to true if the canonical board is the transposed one.
+ *
+ * @return the 64-bit hash of the canonical board.
+ */
+unsigned long long canonical_board(const char board[9][9], char canonical[9][9], char relabel[9],
+                                   bool& transposed)
+{
+  return canonicalise(board, true, true, canonical, relabel, transposed);
+}
+
+/**
+ * Creates an empty database file.
+ *
+ * @param filename - a constant character pointer to the database-file path.
+ * @param capacity - the number of slots, rounded up to a power of two.
+ *
+ * @return SUDOKU_OK - if the file was created, otherwise the code describing the failure.
+ */
+SudokuStatus solution_db_create(const char* filename, unsigned long long capacity)
+{
+  return solution_db_create(filename, capacity, classic_topology());
+}
+
+/**
+ * Creates an empty database file for the puzzles of a variant.
+ *
+ * @param filename - a constant character pointer to the database-file path.
+ * @param capacity - the number of slots, rounded up to a power of two.
+ * @param topology - the units the records will be computed under.
+ *
+ * @return SUDOKU_OK - if the file was created, otherwise the code describing the failure.
+ */
+SudokuStatus solution_db_create(const char* filename, unsigned long long capacity,
+                                const Topology& topology)
+{
+  if (!filename || !capacity)
+  {
+    return SUDOKU_ERROR_INVALID_ARGUMENT;
+  }
+  unsigned long long slots = 1;
+  while (slots < capacity)
+  {
+    slots <<= 1;
+  }
+
+  const int fd = open(filename, O_RDWR | O_CREAT | O_EXCL, 0644);
+  if (fd < 0)
+  {
+    return SUDOKU_ERROR_OPEN_FAILED;
+  }
+
+  // The slots start out as zeroes (SLOT_EMPTY) in a sparse file
+  DbHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, DB_MAGIC, 8);
+  header.version = DB_VERSION;
+  header.slot_size = sizeof(DbSlot);
+  header.capacity = slots;
+  header.topology = topology_fingerprint(topology);
+
+  const bool written = ftruncate(fd, sizeof(DbHeader) + slots * sizeof(DbSlot)) == 0 &&
+                       pwrite(fd, &header, sizeof(header), 0) == (ssize_t) sizeof(header);
+  if (close(fd) != 0 || !written)
+  {
+    unlink(filename);
+    return SUDOKU_ERROR_WRITE_FAILED;
+  }
+  return SUDOKU_OK;
+}
+
+/**
+ * Opens and maps a database file.
+ *
+ * @param filename - a constant character pointer to the database-file path.
+ * @param writable - whether records will be inserted.
+ * @param db - the database handle to fill in.
+ *
+ * @return SUDOKU_OK - if the database was opened, otherwise the code describing the failure.
+ */
+SudokuStatus solution_db_open(const char* filename, bool writable, SolutionDb& db)
+{
+  return solution_db_open(filename, writable, classic_topology(), db);
+}
+
+/**
+ * Opens and maps a database file built for a variant.
+ *
+ * @param filename - a constant character pointer to the database-file path.
+ * @param writable - whether records will be inserted.
+ * @param topology - the units the caller's records are computed under.
+ * @param db - the database handle to fill in.
+ *
+ * @return SUDOKU_OK - if the database was opened, otherwise the code describing the failure.
+ */
+SudokuStatus solution_db_open(const char* filename, bool writable, const Topology& topology,
+                              SolutionDb& db)
+{
+  if (!filename)
+  {
+    return SUDOKU_ERROR_INVALID_ARGUMENT;
+  }
+
+  const int fd = open(filename, writable ? O_RDWR : O_RDONLY);
+  if (fd < 0)
+  {
+    return SUDOKU_ERROR_OPEN_FAILED;
+  }
+  if (writable && flock(fd, LOCK_EX) != 0)
+  {
+    close(fd);
+    return SUDOKU_ERROR_OPEN_FAILED;
+  }
+
+  struct stat info;
+  DbHeader header;
+  if (fstat(fd, &info) != 0 || pread(fd, &header, sizeof(header), 0) != (ssize_t) sizeof(header) ||
+      memcmp(header.magic, DB_MAGIC, 8) != 0 || header.version != DB_VERSION ||
+      header.slot_size != sizeof(DbSlot) || !header.capacity ||
+      (header.capacity & (header.capacity - 1)) ||
+      (unsigned long long) info.st_size != sizeof(DbHeader) + header.capacity * sizeof(DbSlot))
+  {
+    close(fd);
+    return SUDOKU_ERROR_CORRUPT_DATABASE;
+  }
+
+  // Records only answer lookups under the units they were computed with
+  const unsigned long long fingerprint = topology_fingerprint(topology);
+  if ((header.topology ? header.topology : topology_fingerprint(classic_topology())) != fingerprint)
+  {
+    close(fd);
+    return SUDOKU_ERROR_WRONG_VARIANT;
+  }
+
+  void* map = mmap(NULL, info.st_size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+  if (map == MAP_FAILED)
+  {
+    close(fd);
+    return SUDOKU_ERROR_OPEN_FAILED;
+  }
+
+  db.fd = fd;
+  db.map = map;
+  db.size = info.st_size;
+  db.writable = writable;
+  db.topology = fingerprint;
+  db.transpose = transpose_symmetric(topology);
+  db.relabel = topology.cage_count == 0;
+  return SUDOKU_OK;
+}
+
+/**
+ * Unmaps and closes a database.
+ *
+ * @param db - the database to close.
+ */
+void solution_db_close(SolutionDb& db)
+{
+  if (db.map)
+  {
+    if (db.writable)
+    {
+      msync(db.map, db.size, MS_SYNC);
+    }
+    munmap(db.map, db.size);
+    db.map = NULL;
+  }
+  if (db.fd >= 0)
+  {
+    close(db.fd); // also releases a writer's lock
+    db.fd = -1;
+  }
+}
+
+/**
+ * Looks up a puzzle.
+ *
+ * @param db - an open database.
+ * @param board - the puzzle to look up.
+ * @param record - filled in with the stored record, translated back to this board's labels.
+ *
+ * @return true - if the puzzle is in the database, otherwise false.
+ */
+bool solution_db_lookup(const SolutionDb& db, const char board[9][9], SolutionRecord& record)
+{
+  char canonical[9][9], relabel[9];
+  bool transposed;
+  const unsigned long long hash = canonicalise(board, db.transpose, db.relabel, canonical, relabel,
+                                               transposed);
+
+  const long long index = find_slot(db, hash, canonical);
+  if (index < 0)
+  {
+    return false;
+  }
+  const DbSlot& slot = slots_of(db)[index];
+  if (__atomic_load_n(&slot.state, __ATOMIC_ACQUIRE) != SLOT_READY)
+  {
+    return false;
+  }
+
+  record.solved = slot.solution_count > 0;
+  record.solution_count = slot.solution_count;
+  record.backtracks = slot.backtracks;
+  record.difficulty = slot.difficulty;
+  if (record.solved)
+  {
+    decanonicalise((const char (*)[9]) slot.solution, relabel, transposed, record.solution);
+  }
+  return true;
+}
+
+/**
+ * Adds a puzzle and its record to the database.
+ *
+ * @param db - a database opened for writing.
+ * @param board - the puzzle.
+ * @param record - what is known about it.
+ *
+ * @return SUDOKU_OK - if the record was added or already present, otherwise
+ *         SUDOKU_ERROR_DATABASE_FULL or SUDOKU_ERROR_INVALID_ARGUMENT.
+ */
+SudokuStatus solution_db_insert(SolutionDb& db, const char board[9][9], const SolutionRecord& record)
+{
+  if (!db.writable)
+  {
+    return SUDOKU_ERROR_INVALID_ARGUMENT;
+  }
+
+  char canonical[9][9], relabel[9];
+  bool transposed;
+  const unsigned long long hash = canonicalise(board, db.transpose, db.relabel, canonical, relabel,
+                                               transposed);
+
+  DbHeader* header = header_of(db);
+  const long long index = find_slot(db, hash, canonical);
+  if (index < 0)
+  {
+    return SUDOKU_ERROR_DATABASE_FULL;
+  }
+  DbSlot& slot = slots_of(db)[index];
+  if (slot.state == SLOT_READY)
+  {
+    return SUDOKU_OK;
+  }
+
+  // Keep probe sequences short by refusing to fill the table beyond 90%
+  if (header->count * 10 >= header->capacity * 9)
+  {
+    return SUDOKU_ERROR_DATABASE_FULL;
+  }
+
+  // Store the solution in the same labels and orientation as the canonical puzzle
+  memset(slot.solution, '.', 81);
+  if (record.solved)
+  {
+    for (int row = 0; row < 9; row++)
+    {
+      for (int column = 0; column < 9; column++)
+      {
+        const char cell = transposed ? record.solution[column][row] : record.solution[row][column];
+        slot.solution[row * 9 + column] = relabel[cell - '1'];
+      }
+    }
+  }
+  slot.hash = hash;
+  slot.difficulty = record.difficulty;
+  slot.solution_count = record.solved ? record.solution_count : 0;
+  slot.backtracks = record.backtracks;
+  memcpy(slot.puzzle, canonical, 81);
+
+  // Publish the slot only once everything else in it is written
+  __atomic_store_n(&slot.state, (unsigned int) SLOT_READY, __ATOMIC_RELEASE);
+  __atomic_add_fetch(&header->count, 1, __ATOMIC_RELEASE);
+  return SUDOKU_OK;
+}
+
+/**
+ * Returns the number of records in a database.
+ *
+ * @param db - an open database.
+ *
+ * @return the number of records.
+ */
+unsigned long long solution_db_count(const SolutionDb& db)
+{
+  return __atomic_load_n(&header_of(db)->count, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * Solves a classic puzzle and fills in a record for it.
+ *
+ * @param board - the puzzle.
+ * @param count_limit - the most solutions to count (at least 1).
+ * @param record - the record to fill in.
+ */
+void solution_record_compute(const char board[9][9], long long count_limit, SolutionRecord& record)
+{
+  solution_record_compute(board, classic_topology(), count_limit, record);
+}
+
+/**
+ * Solves a puzzle of a variant and fills in a record for it.
+ *
+ * @param board - the puzzle.
+ * @param topology - the units of the variant.
+ * @param count_limit - the most solutions to count (at least 1).
+ * @param record - the record to fill in.
+ */
+void solution_record_compute(const char board[9][9], const Topology& topology,
+                             long long count_limit, SolutionRecord& record)
+{
+  SearchState state;
+  search_init(state, board, topology);
+
+  record.solved = search_next(state);
+  record.backtracks = state.backtracks;
+  record.solution_count = record.solved ? 1 : 0;
+  if (record.solved)
+  {
+    memcpy(record.solution, state.board, 81);
+    while (record.solution_count < count_limit && search_next(state))
+    {
+      record.solution_count++;
+    }
+  }
+
+  // The move score counts the digits each empty cell can take under the variant's units
+  record.difficulty = 0;
+  for (int row = 0; row < 9; row++)
+  {
+    for (int column = 0; column < 9; column++)
+    {
+      for (char digit = '1'; digit <= '9'; digit++)
+      {
+        record.difficulty += is_move_valid(row, column, digit, board, topology);
+      }
+    }
+  }
+}
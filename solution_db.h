@@ -0,0 +1,230 @@
+#ifndef SOLUTION_DB_H
+#define SOLUTION_DB_H
+
+#include "sudoku.h"
+#include "topology.h"
+
+/* PERSISTENT SOLUTION DATABASE */
+
+/**
+ * What the database knows about a puzzle.
+ *
+ * solved - whether the puzzle has a solution.
+ * solution - the first solution in search order (unchanged if there is none).
+ * solution_count - the number of solutions, counted up to the limit used when the record
+ *                  was computed (so 2 means "2 or more" with the default limit).
+ * backtracks - the backtracking score, as counted by solve_board(board, count).
+ * difficulty - the move score of the puzzle (total_valid_moves, counted under the variant's
+ *              units), as used in findings.txt.
+ *
+ * Boards that share a canonical form share one record, so backtracks and difficulty are
+ * those of whichever of them was stored first.
+ */
+struct SolutionRecord
+{
+  bool solved;
+  char solution[9][9];
+  long long solution_count;
+  long long backtracks;
+  int difficulty;
+};
+
+
+
+
+/**
+ * An open database file, mapped into memory.
+ *
+ * The file is an open-addressing hash table: a small header followed by fixed-size slots.
+ * Lookups read the mapping directly, with no deserialization and no locks.
+ *
+ * A database holds the puzzles of one variant: its header records the fingerprint of the
+ * units its records were computed under, and it only opens under the same units.
+ *
+ * topology - the fingerprint of the variant's units.
+ * transpose - whether a board and its transpose share a record (only if the variant's units
+ *             are unchanged by swapping rows and columns).
+ * relabel - whether boards that differ by a relabelling of the digits share a record (not
+ *           with killer cages, whose sums depend on the digits).
+ */
+struct SolutionDb
+{
+  int fd;
+  void* map;
+  unsigned long long size;
+  bool writable;
+  unsigned long long topology;
+  bool transpose;
+  bool relabel;
+};
+
+
+
+
+/**
+ * Puts a board into canonical form, so that boards differing only by a relabelling of the
+ * digits or by a transposition share one database entry.
+ *
+ * The digits are renumbered in order of first appearance (row by row) and the smaller of
+ * the board and its transpose is kept.
+ *
+ * @param board - a 9x9 character array representing the sudoku board.
+ * @param canonical - a 9x9 character array that will hold the canonical board.
+ * @param relabel - filled in with the new label of each digit ('1'-'9' at index d - 1).
+ * @param transposed - set to true if the canonical board is the transposed one.
+ *
+ * @return the 64-bit hash of the canonical board.
+ */
+unsigned long long canonical_board(const char board[9][9], char canonical[9][9], char relabel[9],
+                                   bool& transposed);
+
+
+
+
+/**
+ * Creates an empty database file.
+ *
+ * @param filename - a constant character pointer to the database-file path.
+ * @param capacity - the number of slots, rounded up to a power of two; the table accepts
+ *        records until it is 90% full.
+ *
+ * @return SUDOKU_OK - if the file was created, otherwise the code describing the failure.
+ */
+SudokuStatus solution_db_create(const char* filename, unsigned long long capacity);
+
+
+
+
+/**
+ * Creates an empty database file for the puzzles of a variant.
+ *
+ * @param filename - a constant character pointer to the database-file path.
+ * @param capacity - the number of slots, rounded up to a power of two; the table accepts
+ *        records until it is 90% full.
+ * @param topology - the units the records will be computed under.
+ *
+ * @return SUDOKU_OK - if the file was created, otherwise the code describing the failure.
+ */
+SudokuStatus solution_db_create(const char* filename, unsigned long long capacity,
+                                const Topology& topology);
+
+
+
+
+/**
+ * Opens and maps a database file.
+ *
+ * Any number of processes may open the same file for reading. Writers take an exclusive
+ * lock on the file for as long as it is open, so only one bulk build runs at a time; readers
+ * can keep looking up records while it does.
+ *
+ * @param filename - a constant character pointer to the database-file path.
+ * @param writable - whether records will be inserted.
+ * @param db - the database handle to fill in.
+ *
+ * @return SUDOKU_OK - if the database was opened, otherwise the code describing the failure
+ *         (SUDOKU_ERROR_WRONG_VARIANT if it was built for a variant).
+ */
+SudokuStatus solution_db_open(const char* filename, bool writable, SolutionDb& db);
+
+
+
+
+/**
+ * Opens and maps a database file built for a variant.
+ *
+ * @param filename - a constant character pointer to the database-file path.
+ * @param writable - whether records will be inserted.
+ * @param topology - the units the caller's records are computed under.
+ * @param db - the database handle to fill in.
+ *
+ * @return SUDOKU_OK - if the database was opened, otherwise the code describing the failure
+ *         (SUDOKU_ERROR_WRONG_VARIANT if it was built for other units).
+ */
+SudokuStatus solution_db_open(const char* filename, bool writable, const Topology& topology,
+                              SolutionDb& db);
+
+
+
+
+/**
+ * Unmaps and closes a database.
+ *
+ * @param db - the database to close.
+ */
+void solution_db_close(SolutionDb& db);
+
+
+
+
+/**
+ * Looks up a puzzle.
+ *
+ * @param db - an open database.
+ * @param board - the puzzle to look up.
+ * @param record - filled in with the stored record, translated back to this board's labels.
+ *
+ * @return true - if the puzzle is in the database, otherwise false.
+ */
+bool solution_db_lookup(const SolutionDb& db, const char board[9][9], SolutionRecord& record);
+
+
+
+
+/**
+ * Adds a puzzle and its record to the database.
+ *
+ * Records are never changed once written: inserting a puzzle that is already present
+ * leaves the stored record as it is. The slot is filled in first and only then marked as
+ * ready, so concurrent readers never see a half-written record.
+ *
+ * @param db - a database opened for writing.
+ * @param board - the puzzle.
+ * @param record - what is known about it.
+ *
+ * @return SUDOKU_OK - if the record was added or already present, otherwise
+ *         SUDOKU_ERROR_DATABASE_FULL or SUDOKU_ERROR_INVALID_ARGUMENT.
+ */
+SudokuStatus solution_db_insert(SolutionDb& db, const char board[9][9], const SolutionRecord& record);
+
+
+
+
+/**
+ * Returns the number of records in a database.
+ *
+ * @param db - an open database.
+ *
+ * @return the number of records.
+ */
+unsigned long long solution_db_count(const SolutionDb& db);
+
+
+
+
+/**
+ * Solves a puzzle and fills in a record for it.
+ *
+ * @param board - the puzzle.
+ * @param count_limit - the most solutions to count (at least 1; 2 is enough to tell whether
+ *        the solution is unique).
+ * @param record - the record to fill in.
+ */
+void solution_record_compute(const char board[9][9], long long count_limit, SolutionRecord& record);
+
+
+
+
+/**
+ * Solves a puzzle of a variant and fills in a record for it.
+ *
+ * @param board - the puzzle.
+ * @param topology - the units of the variant.
+ * @param count_limit - the most solutions to count (at least 1; 2 is enough to tell whether
+ *        the solution is unique).
+ * @param record - the record to fill in.
+ */
+void solution_record_compute(const char board[9][9], const Topology& topology,
+                             long long count_limit, SolutionRecord& record);
+
+#endif
@@ -1,74 +1,283 @@
-#include <iostream>
 #include <fstream>
-#include <cstdio>
-#include <cstring>
-#include <cassert>
+#include <sstream>
+#include <string>
 #include "sudoku.h"
 
 using namespace std;
 
-/* You are pre-supplied with the functions below. Add your own 
-   function definitions to the end of this file. */
+/* The solver core is built as a library, so nothing in this file prints or aborts;
+   failures are reported through return values. The display functions live in
+   display.cpp, which is only part of the demonstration program. */
 
-/* pre-supplied function to load a Sudoku board from a file */
-void load_board(const char* filename, char board[9][9]) {
+/* LIBRARY INPUT AND OUTPUT */
 
-  cout << "Loading Sudoku board from file '" << filename << "'... ";
+/**
+ * Converts one character of a board file into a cell value.
+ *
+ * @param character - the character read from the input.
+ * @param cell - a reference that will be set to the cell value ('1'-'9' or '.').
+ *
+ * @return true - if the character is a valid cell, otherwise false.
+ */
+static bool parse_cell(char character, char& cell)
+{
+  if (character == '.' || character == '0')
+  {
+    cell = '.';
+    return true;
+  }
+  if (character >= '1' && character <= '9')
+  {
+    cell = character;
+    return true;
+  }
+  return false;
+}
 
-  ifstream in(filename);
-  if (!in) {
-    cout << "Failed!\n";
+/**
+ * Finds the length of the line starting at a position, without its line ending.
+ *
+ * @param buffer - the characters being parsed.
+ * @param length - the number of characters in the buffer.
+ * @param start - the position the line starts at.
+ * @param next - a reference that will be set to the position of the following line.
+ *
+ * @return the number of characters on the line, not counting "\n" or "\r\n".
+ */
+static size_t line_length(const char* buffer, size_t length, size_t start, size_t& next)
+{
+  size_t end = start;
+  while (end < length && buffer[end] != '\n')
+  {
+    end++;
   }
-  assert(in);
+  next = (end < length) ? end + 1 : end;
+  if (end > start && buffer[end - 1] == '\r')
+  {
+    end--;
+  }
+  return end - start;
+}
 
-  char buffer[512];
+/**
+ * Parses a 9x9 grid of characters from a memory buffer, in either board layout.
+ *
+ * The grid is parsed into a temporary copy first, so it is left unchanged if any part of
+ * the buffer is invalid.
+ *
+ * @param buffer - the characters to parse (need not be null-terminated).
+ * @param length - the number of characters in the buffer.
+ * @param convert - turns one character into a grid entry, returning false if it is invalid.
+ * @param grid - a 9x9 character array that will hold the entries.
+ *
+ * @return SUDOKU_OK - if the grid was parsed, otherwise the code describing the failure.
+ */
+SudokuStatus parse_grid(const char* buffer, size_t length, bool (*convert)(char character, char& entry),
+                        char grid[9][9])
+{
+  if (!buffer || !convert || !grid)
+  {
+    return SUDOKU_ERROR_INVALID_ARGUMENT;
+  }
+
+  char parsed[9][9];
+  size_t next;
+  const size_t first = line_length(buffer, length, 0, next);
+
+  if (first >= 81)
+  {
+    // Single-line layout: all 81 cells on the first line
+    for (int i = 0; i < 81; i++)
+    {
+      if (!convert(buffer[i], parsed[i / 9][i % 9]))
+      {
+        return SUDOKU_ERROR_INVALID_CHARACTER;
+      }
+    }
+  }
+  else
+  {
+    // Nine-line layout: the first nine characters of each of the first nine lines
+    size_t start = 0;
+    for (int row = 0; row < 9; row++)
+    {
+      if (start >= length)
+      {
+        return SUDOKU_ERROR_TOO_FEW_ROWS;
+      }
+      if (line_length(buffer, length, start, next) < 9)
+      {
+        return SUDOKU_ERROR_ROW_TOO_SHORT;
+      }
+      for (int column = 0; column < 9; column++)
+      {
+        if (!convert(buffer[start + column], parsed[row][column]))
+        {
+          return SUDOKU_ERROR_INVALID_CHARACTER;
+        }
+      }
+      start = next;
+    }
+  }
 
-  int row = 0;
-  in.getline(buffer,512);
-  while (in && row < 9) {
-    for (int n=0; n<9; n++) {
-      assert(buffer[n] == '.' || isdigit(buffer[n]));
-      board[row][n] = buffer[n];
+  for (int row = 0; row < 9; row++)
+  {
+    for (int column = 0; column < 9; column++)
+    {
+      grid[row][column] = parsed[row][column];
     }
-    row++;
-    in.getline(buffer,512);
   }
+  return SUDOKU_OK;
+}
 
-  cout << ((row == 9) ? "Success!" : "Failed!") << '\n';
-  assert(row == 9);
+/**
+ * Parses a sudoku board from a memory buffer.
+ *
+ * This function accepts either the nine-line layout of the .dat files or a single line
+ * of 81 cells. The board is parsed into a temporary copy first, so it is left unchanged
+ * if any part of the buffer is invalid.
+ *
+ * @param buffer - the characters to parse (need not be null-terminated).
+ * @param length - the number of characters in the buffer.
+ * @param board - a 9x9 character array that will hold the board.
+ *
+ * @return SUDOKU_OK - if the board was parsed, otherwise the code describing the failure.
+ */
+SudokuStatus parse_board(const char* buffer, size_t length, char board[9][9])
+{
+  return parse_grid(buffer, length, parse_cell, board);
 }
 
-/* internal helper function */
-void print_frame(int row) {
-  if (!(row % 3)) {
-    cout << "  +===========+===========+===========+\n";
-  } else {
-    cout << "  +---+---+---+---+---+---+---+---+---+\n";
+/**
+ * Reads a sudoku board from a file.
+ *
+ * @param filename - a constant character pointer to the input-file path.
+ * @param board - a 9x9 character array that will hold the board.
+ *
+ * @return SUDOKU_OK - if the board was read, otherwise the code describing the failure.
+ */
+SudokuStatus read_board_file(const char* filename, char board[9][9])
+{
+  if (!filename)
+  {
+    return SUDOKU_ERROR_INVALID_ARGUMENT;
   }
-}
 
-/* internal helper function */
-void print_row(const char* data, int row) {
-  cout << (char) ('A' + row) << " ";
-  for (int i=0; i<9; i++) {
-    cout << ( (i % 3) ? ':' : '|' ) << " ";
-    cout << ( (data[i]=='.') ? ' ' : data[i]) << " ";
+  ifstream in(filename);
+  if (!in)
+  {
+    return SUDOKU_ERROR_OPEN_FAILED;
   }
-  cout << "|\n";
+
+  ostringstream contents;
+  contents << in.rdbuf();
+  const string text = contents.str();
+  return parse_board(text.data(), text.size(), board);
 }
 
-/* pre-supplied function to display a Sudoku board */
-void display_board(const char board[9][9]) {
-  cout << "    ";
-  for (int r=0; r<9; r++) {
-    cout << (char) ('1'+r) << "   ";
+/**
+ * Writes a sudoku board to a file in the nine-line .dat layout.
+ *
+ * @param filename - a constant character pointer to the output-file path.
+ * @param board - a 9x9 character array representing the sudoku board.
+ *
+ * @return SUDOKU_OK - if the board was written, otherwise the code describing the failure.
+ */
+SudokuStatus write_board_file(const char* filename, const char board[9][9])
+{
+  if (!filename || !board)
+  {
+    return SUDOKU_ERROR_INVALID_ARGUMENT;
+  }
+
+  ofstream out_stream;
+
+  // Open the output-file stream 
+  out_stream.open(filename);
+
+  // Check whether the stream opened successfully 
+  if (out_stream.fail()) 
+  {
+    return SUDOKU_ERROR_OPEN_FAILED;
   }
-  cout << '\n';
-  for (int r=0; r<9; r++) {
-    print_frame(r);
-    print_row(board[r],r);
+
+  // Lay the nine rows out in one buffer and write it at once; the stream is flushed only
+  // when it is closed
+  char text[90];
+  for (int row = 0; row < 9; row++)
+  {
+    for (int column = 0; column < 9; column++)
+    {
+      text[row * 10 + column] = board[row][column];
+    }
+    text[row * 10 + 9] = '\n';
+  }
+  out_stream.write(text, sizeof(text));
+
+  // Close the stream
+  out_stream.close();
+
+  // Check again that there has not been any output errors 
+  if (out_stream.fail()) 
+  {
+    return SUDOKU_ERROR_WRITE_FAILED;
+  }
+  return SUDOKU_OK;
+}
+
+/**
+ * Returns a short description of a status code.
+ *
+ * @param status - the status code to describe.
+ *
+ * @return a constant C-string describing the status.
+ */
+const char* sudoku_status_message(SudokuStatus status)
+{
+  switch (status)
+  {
+    case SUDOKU_OK:
+      return "success";
+    case SUDOKU_ERROR_INVALID_ARGUMENT:
+      return "invalid argument";
+    case SUDOKU_ERROR_OPEN_FAILED:
+      return "file could not be opened";
+    case SUDOKU_ERROR_TOO_FEW_ROWS:
+      return "fewer than nine rows";
+    case SUDOKU_ERROR_ROW_TOO_SHORT:
+      return "row has fewer than nine cells";
+    case SUDOKU_ERROR_INVALID_CHARACTER:
+      return "invalid character in board";
+    case SUDOKU_ERROR_WRITE_FAILED:
+      return "file could not be written";
+    case SUDOKU_ERROR_CORRUPT_CHECKPOINT:
+      return "checkpoint is damaged or does not match its puzzle";
+    case SUDOKU_ERROR_WORKER_FAILED:
+      return "worker could not be started";
+    case SUDOKU_ERROR_CORRUPT_DATABASE:
+      return "file is not a valid solution database";
+    case SUDOKU_ERROR_DATABASE_FULL:
+      return "solution database is full";
+    case SUDOKU_ERROR_INVALID_REGIONS:
+      return "region map does not form nine regions of nine cells";
+    case SUDOKU_ERROR_INVALID_CAGE:
+      return "invalid killer cage";
+    case SUDOKU_ERROR_UNSUPPORTED_FORMAT:
+      return "compression format not supported by this build";
+    case SUDOKU_ERROR_CORRUPT_STREAM:
+      return "compressed data is damaged or incomplete";
+    case SUDOKU_ERROR_OUT_OF_MEMORY:
+      return "out of memory";
+    case SUDOKU_ERROR_INVALID_RING:
+      return "shared-memory segment is not a solver ring";
+    case SUDOKU_ERROR_RING_FULL:
+      return "solver ring is full";
+    case SUDOKU_ERROR_RING_STOPPED:
+      return "solver ring has stopped";
+    case SUDOKU_ERROR_WRONG_VARIANT:
+      return "file was built for a different sudoku variant";
   }
-  print_frame(9);
+  return "unknown status";
 }
 
 /* MY HELPER FUNCTIONS */
@@ -325,6 +534,12 @@ bool is_complete(const char board[9][9])
  */
 bool make_move(const char* position, const char digit, char board[9][9])
 {
+  // A missing or too-short position string cannot name a cell
+  if (!position || !position[0] || !position[1])
+  {
+    return false;
+  }
+
   // Convert position string variable to a row integer and column integer index
   const int row = position[0] - 'A';
   const int column = position[1] - '1';
@@ -361,38 +576,9 @@ bool make_move(const char* position, const char digit, char board[9][9])
  */
 bool save_board(const char filename[], const char board[9][9])
 {
-  ofstream out_stream;
-
-  // Open the output-file stream 
-  out_stream.open(filename);
-
-  // Check whether the stream opened successfully 
-  if (out_stream.fail()) 
-  {
-    return false;
-  }
-
-  // Loop that outputs each cell value into the file
-  for (int row = 0; row < 9; row++) 
-  {
-    for (int column = 0; column < 9; column++) 
-    {
-      out_stream.put(board[row][column]);
-    }
-    out_stream << endl;
-  }
-
-  // Close the stream
-  out_stream.close();
-
-  // Check again that there has not been any output errors 
-  if (out_stream.fail()) 
-  {
-    return false;
-  }
-
-  // If no failure exists, the file has been successfully saved and return true 
-  return true;
+  // The file handling (open, write each row, check for output errors) lives in
+  // write_board_file, which reports exactly what went wrong
+  return write_board_file(filename, board) == SUDOKU_OK;
 }
 
 /* QUESTION 4 */
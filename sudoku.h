@@ -1,10 +1,121 @@
 #ifndef SUDOKU_H
 #define SUDOKU_H
 
-/* PREDEFINED HELPER FUNCTIONS */
+#include <cstddef>
 
-void load_board(const char* filename, char board[9][9]);
-void display_board(const char board[9][9]);
+/* LIBRARY INPUT AND OUTPUT */
+
+/**
+ * Status codes returned by the library instead of printing or aborting.
+ */
+enum SudokuStatus
+{
+  SUDOKU_OK,
+  SUDOKU_ERROR_INVALID_ARGUMENT,  // a null pointer or similar was passed in
+  SUDOKU_ERROR_OPEN_FAILED,       // the file could not be opened
+  SUDOKU_ERROR_TOO_FEW_ROWS,      // the input ended before nine rows were read
+  SUDOKU_ERROR_ROW_TOO_SHORT,     // a row held fewer than nine cells
+  SUDOKU_ERROR_INVALID_CHARACTER, // a cell was not '1'-'9', '.' or '0'
+  SUDOKU_ERROR_WRITE_FAILED,      // the file could not be written
+  SUDOKU_ERROR_CORRUPT_CHECKPOINT,// a checkpoint file is damaged or does not fit its puzzle
+  SUDOKU_ERROR_WORKER_FAILED,     // a worker process or thread could not be started
+  SUDOKU_ERROR_CORRUPT_DATABASE,  // a file is not a valid solution database
+  SUDOKU_ERROR_DATABASE_FULL,     // the solution database has no room for another record
+  SUDOKU_ERROR_INVALID_REGIONS,   // a region map does not split the board into nine regions of nine
+  SUDOKU_ERROR_INVALID_CAGE,      // a killer cage names a bad or repeated cell, or has an impossible sum
+  SUDOKU_ERROR_UNSUPPORTED_FORMAT,// a file is compressed in a format this build cannot read or write
+  SUDOKU_ERROR_CORRUPT_STREAM,    // compressed data is damaged or cut short
+  SUDOKU_ERROR_OUT_OF_MEMORY,     // memory for a table could not be allocated
+  SUDOKU_ERROR_INVALID_RING,      // a shared-memory segment is not a solver ring
+  SUDOKU_ERROR_RING_FULL,         // every slot of a shared-memory ring is in use
+  SUDOKU_ERROR_RING_STOPPED,      // the solver serving a shared-memory ring has stopped
+  SUDOKU_ERROR_WRONG_VARIANT      // a file was built for a different sudoku variant
+};
+
+
+
+
+/**
+ * Parses a sudoku board from a memory buffer.
+ *
+ * Two layouts are accepted: the nine-line layout of the .dat files (only the first nine
+ * characters of each line are read), and a single line of 81 cells. Empty cells may be
+ * written as '.' or '0' and are stored as '.'. Lines may end in "\n" or "\r\n".
+ *
+ * The function has no side effects: it prints nothing and does not change the board
+ * unless the whole buffer parses successfully.
+ *
+ * @param buffer - the characters to parse (need not be null-terminated).
+ * @param length - the number of characters in the buffer.
+ * @param board - a 9x9 character array that will hold the board.
+ *
+ * @return SUDOKU_OK - if the board was parsed, otherwise the code describing the failure.
+ */
+SudokuStatus parse_board(const char* buffer, size_t length, char board[9][9]);
+
+
+
+
+/**
+ * Parses a 9x9 grid of characters from a memory buffer, in either layout parse_board accepts.
+ *
+ * This is the layout parser behind parse_board (and parse_regions, in topology.h), so every
+ * kind of grid file is split into lines the same way; only the meaning of each character
+ * differs, and that is left to a converter.
+ *
+ * @param buffer - the characters to parse (need not be null-terminated).
+ * @param length - the number of characters in the buffer.
+ * @param convert - turns one character into a grid entry, returning false if it is invalid.
+ * @param grid - a 9x9 character array that will hold the entries; it is left unchanged if
+ *        any part of the buffer is invalid.
+ *
+ * @return SUDOKU_OK - if the grid was parsed, otherwise SUDOKU_ERROR_INVALID_ARGUMENT,
+ *         SUDOKU_ERROR_TOO_FEW_ROWS, SUDOKU_ERROR_ROW_TOO_SHORT or
+ *         SUDOKU_ERROR_INVALID_CHARACTER.
+ */
+SudokuStatus parse_grid(const char* buffer, size_t length, bool (*convert)(char character, char& entry),
+                        char grid[9][9]);
+
+
+
+
+/**
+ * Reads a sudoku board from a file.
+ *
+ * The file is read into memory and parsed with parse_board, so both layouts are accepted.
+ * The board is not changed unless the whole file parses successfully.
+ *
+ * @param filename - a constant character pointer to the input-file path.
+ * @param board - a 9x9 character array that will hold the board.
+ *
+ * @return SUDOKU_OK - if the board was read, otherwise the code describing the failure.
+ */
+SudokuStatus read_board_file(const char* filename, char board[9][9]);
+
+
+
+
+/**
+ * Writes a sudoku board to a file in the nine-line .dat layout.
+ *
+ * @param filename - a constant character pointer to the output-file path.
+ * @param board - a 9x9 character array representing the sudoku board.
+ *
+ * @return SUDOKU_OK - if the board was written, otherwise the code describing the failure.
+ */
+SudokuStatus write_board_file(const char* filename, const char board[9][9]);
+
+
+
+
+/**
+ * Returns a short description of a status code.
+ *
+ * @param status - the status code to describe.
+ *
+ * @return a constant C-string describing the status.
+ */
+const char* sudoku_status_message(SudokuStatus status);
 
 /* FUNCTIONS MENTIONED IN SPEC */
 
@@ -0,0 +1,388 @@
+#include <fstream>
+#include <sstream>
+#include <string>
+#include "topology.h"
+#include "killer.h"
+
+using namespace std;
+
+/* INTERNAL HELPERS */
+
+/**
+ * Takes a character of a region map as its label; the labels are checked when the
+ * topology is built.
+ *
+ * @param character - the character read from the input.
+ * @param label - a reference that will be set to the label.
+ *
+ * @return true, as any character can be a label.
+ */
+static bool parse_label(char character, char& label)
+{
+  label = character;
+  return true;
+}
+
+/**
+ * Adds a unit to a topology and records it against each of its cells.
+ *
+ * @param topology - the topology being built.
+ * @param cells - the nine cells of the unit.
+ * @param type - the kind of unit.
+ * @param number - the number of the unit among units of its kind.
+ */
+static void add_unit(Topology& topology, const unsigned char cells[9], UnitType type, int number)
+{
+  const int unit = topology.unit_count++;
+  topology.unit_type[unit] = type;
+  topology.unit_number[unit] = number;
+  for (int k = 0; k < 9; k++)
+  {
+    const int cell = cells[k];
+    topology.units[unit][k] = cell;
+    topology.cell_units[cell][topology.cell_unit_count[cell]++] = unit;
+  }
+}
+
+/**
+ * Fills in the peer set and the placement keys of every cell from the unit lists.
+ *
+ * @param topology - the topology being built, with every unit added.
+ */
+static void compile_peers(Topology& topology)
+{
+  for (int cell = 0; cell < 81; cell++)
+  {
+    topology.peers[cell][0] = topology.peers[cell][1] = 0;
+    for (int i = 0; i < topology.cell_unit_count[cell]; i++)
+    {
+      const unsigned char* unit = topology.units[topology.cell_units[cell][i]];
+      for (int k = 0; k < 9; k++)
+      {
+        topology.peers[cell][unit[k] / 64] |= 1ULL << (unit[k] % 64);
+      }
+    }
+    // A cell is not its own peer
+    topology.peers[cell][cell / 64] &= ~(1ULL << (cell % 64));
+
+    for (int d = 0; d < 9; d++)
+    {
+      topology.placement_keys[cell][d] = 0;
+      for (int i = 0; i < topology.cell_unit_count[cell]; i++)
+      {
+        topology.placement_keys[cell][d] ^= unit_digit_key(topology.cell_units[cell][i], d);
+      }
+    }
+  }
+}
+
+/* TOPOLOGIES */
+
+/**
+ * Returns the topology of classic sudoku: 9 rows, 9 columns and 9 subgrids.
+ *
+ * @return a reference to a shared, read-only classic topology.
+ */
+const Topology& classic_topology()
+{
+  static const Topology classic = []
+  {
+    Topology topology;
+    build_topology(NULL, false, topology);
+    return topology;
+  }();
+  return classic;
+}
+
+/**
+ * Builds a topology from a region map, optionally with the two main diagonals.
+ *
+ * Units are numbered rows first, then columns, then subgrids or regions, then diagonals,
+ * so the units of the classic topology are numbered 9 * unit type + unit number.
+ *
+ * @param regions - a 9x9 array of region labels (any nine distinct characters), or NULL.
+ * @param diagonals - whether to add the two main diagonals as units.
+ * @param topology - the topology to build.
+ *
+ * @return SUDOKU_OK - if the topology was built, otherwise SUDOKU_ERROR_INVALID_REGIONS.
+ */
+SudokuStatus build_topology(const char regions[9][9], bool diagonals, Topology& topology)
+{
+  // Group the cells of each region before changing the topology, so a bad map leaves it alone
+  unsigned char region_cells[9][9];
+  if (regions)
+  {
+    char labels[9];
+    int label_count = 0, sizes[9] = {};
+    for (int cell = 0; cell < 81; cell++)
+    {
+      const char label = regions[cell / 9][cell % 9];
+      int region = 0;
+      while (region < label_count && labels[region] != label)
+      {
+        region++;
+      }
+      if (region == label_count)
+      {
+        if (label_count == 9)
+        {
+          return SUDOKU_ERROR_INVALID_REGIONS;
+        }
+        labels[label_count++] = label;
+      }
+      if (sizes[region] == 9)
+      {
+        return SUDOKU_ERROR_INVALID_REGIONS;
+      }
+      region_cells[region][sizes[region]++] = cell;
+    }
+  }
+
+  topology.unit_count = 0;
+  topology.cage_count = 0;
+  for (int cell = 0; cell < 81; cell++)
+  {
+    topology.cell_unit_count[cell] = 0;
+    topology.cell_cage[cell] = -1;
+  }
+
+  unsigned char cells[9];
+  for (int row = 0; row < 9; row++)
+  {
+    for (int k = 0; k < 9; k++)
+    {
+      cells[k] = row * 9 + k;
+    }
+    add_unit(topology, cells, UNIT_ROW, row);
+  }
+  for (int column = 0; column < 9; column++)
+  {
+    for (int k = 0; k < 9; k++)
+    {
+      cells[k] = k * 9 + column;
+    }
+    add_unit(topology, cells, UNIT_COLUMN, column);
+  }
+  for (int index = 0; index < 9; index++)
+  {
+    if (regions)
+    {
+      add_unit(topology, region_cells[index], UNIT_REGION, index);
+      continue;
+    }
+    for (int k = 0; k < 9; k++)
+    {
+      cells[k] = ((index / 3) * 3 + k / 3) * 9 + (index % 3) * 3 + k % 3;
+    }
+    add_unit(topology, cells, UNIT_SUBGRID, index);
+  }
+  if (diagonals)
+  {
+    for (int k = 0; k < 9; k++)
+    {
+      cells[k] = k * 9 + k;
+    }
+    add_unit(topology, cells, UNIT_DIAGONAL, 0);
+    for (int k = 0; k < 9; k++)
+    {
+      cells[k] = k * 9 + 8 - k;
+    }
+    add_unit(topology, cells, UNIT_DIAGONAL, 1);
+  }
+
+  compile_peers(topology);
+  return SUDOKU_OK;
+}
+
+/**
+ * Parses a region map from a memory buffer.
+ *
+ * @param buffer - the characters to parse (need not be null-terminated).
+ * @param length - the number of characters in the buffer.
+ * @param regions - a 9x9 array that will hold the region labels.
+ *
+ * @return SUDOKU_OK - if the map was parsed, otherwise the code describing the failure.
+ */
+SudokuStatus parse_regions(const char* buffer, size_t length, char regions[9][9])
+{
+  if (!buffer || !regions)
+  {
+    return SUDOKU_ERROR_INVALID_ARGUMENT;
+  }
+
+  // The labels are laid out exactly like the cells of a board
+  return parse_grid(buffer, length, parse_label, regions);
+}
+
+/**
+ * Reads a region map file and builds its topology.
+ *
+ * @param filename - a constant character pointer to the region-map path.
+ * @param diagonals - whether to add the two main diagonals as units.
+ * @param topology - the topology to build.
+ *
+ * @return SUDOKU_OK - if the topology was built, otherwise the code describing the failure.
+ */
+SudokuStatus read_topology_file(const char* filename, bool diagonals, Topology& topology)
+{
+  if (!filename)
+  {
+    return SUDOKU_ERROR_INVALID_ARGUMENT;
+  }
+
+  ifstream in(filename);
+  if (!in)
+  {
+    return SUDOKU_ERROR_OPEN_FAILED;
+  }
+
+  ostringstream contents;
+  contents << in.rdbuf();
+  const string text = contents.str();
+
+  char regions[9][9];
+  const SudokuStatus status = parse_regions(text.data(), text.size(), regions);
+  if (status != SUDOKU_OK)
+  {
+    return status;
+  }
+  return build_topology(regions, diagonals, topology);
+}
+
+/**
+ * Returns a 64-bit fingerprint of a topology's units.
+ *
+ * @param topology - the topology.
+ *
+ * @return the fingerprint.
+ */
+unsigned long long topology_fingerprint(const Topology& topology)
+{
+  // FNV-1a over the unit count and the cells of every unit, in order
+  unsigned long long hash = 14695981039346656037ULL;
+  hash = (hash ^ (unsigned long long) topology.unit_count) * 1099511628211ULL;
+  for (int unit = 0; unit < topology.unit_count; unit++)
+  {
+    for (int k = 0; k < 9; k++)
+    {
+      hash = (hash ^ topology.units[unit][k]) * 1099511628211ULL;
+    }
+  }
+
+  // Cages are only mixed in when there are some, so plain topologies keep their fingerprint
+  for (int cage = 0; cage < topology.cage_count; cage++)
+  {
+    hash = (hash ^ topology.cage_sum[cage]) * 1099511628211ULL;
+    for (int k = 0; k < topology.cage_size[cage]; k++)
+    {
+      hash = (hash ^ topology.cage_cells[cage][k]) * 1099511628211ULL;
+    }
+    hash = (hash ^ 0xFF) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+/**
+ * Returns the random 64-bit key of a digit in a unit.
+ *
+ * @param unit - the unit number (cage c is unit MAX_UNITS + c).
+ * @param digit - the digit index (0-8).
+ *
+ * @return the key.
+ */
+unsigned long long unit_digit_key(int unit, int digit)
+{
+  // The splitmix64 finaliser of the (unit, digit) index gives well-spread, repeatable keys
+  unsigned long long key = (unsigned long long) (unit * 9 + digit + 1) * 0x9E3779B97F4A7C15ULL;
+  key = (key ^ (key >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  key = (key ^ (key >> 27)) * 0x94D049BB133111EBULL;
+  return key ^ (key >> 31);
+}
+
+/**
+ * Checks if a digit can be placed in an empty cell under a topology.
+ *
+ * @param row - the row index of the cell (0-8).
+ * @param column - the column index of the cell (0-8).
+ * @param digit - the digit character to be placed.
+ * @param board - a 9x9 character array representing the sudoku board.
+ * @param topology - the units of the variant.
+ *
+ * @return true - if the move is valid, otherwise false.
+ */
+bool is_move_valid(int row, int column, char digit, const char board[9][9], const Topology& topology)
+{
+  if (!are_coordinates_valid(row, column) || !is_digit_valid(digit) ||
+      !is_cell_empty(row, column, board))
+  {
+    return false;
+  }
+
+  // Visit only the peers of the cell, one set bit at a time
+  const int cell = row * 9 + column;
+  for (int word = 0; word < 2; word++)
+  {
+    unsigned long long peers = topology.peers[cell][word];
+    while (peers)
+    {
+      const int peer = word * 64 + __builtin_ctzll(peers);
+      peers &= peers - 1;
+      if (board[peer / 9][peer % 9] == digit)
+      {
+        return false;
+      }
+    }
+  }
+
+  // The peers already rule out a repeat within a cage; the sum still has to be reachable
+  const int cage = topology.cell_cage[cell];
+  if (cage >= 0)
+  {
+    unsigned short used = 0;
+    int sum_left = topology.cage_sum[cage], cells_left = topology.cage_size[cage];
+    for (int k = 0; k < topology.cage_size[cage]; k++)
+    {
+      const int member = topology.cage_cells[cage][k];
+      const char placed = board[member / 9][member % 9];
+      if (placed >= '1' && placed <= '9')
+      {
+        used |= 1 << (placed - '1');
+        sum_left -= placed - '0';
+        cells_left--;
+      }
+    }
+    return (cage_digits(cells_left, sum_left, used) & (1 << (digit - '1'))) != 0;
+  }
+  return true;
+}
+
+/**
+ * Solves a sudoku variant by recursive backtracking.
+ *
+ * @param board - a 9x9 character array representing the current sudoku board.
+ * @param topology - the units of the variant.
+ *
+ * @return true - if the board is successfully solved. Otherwise, it returns false.
+ */
+bool solve_board(char board[9][9], const Topology& topology)
+{
+  int row, column;
+  if (!find_next_empty_cell(row, column, board))
+  {
+    return true;
+  }
+
+  for (char digit = '1'; digit <= '9'; digit++)
+  {
+    if (is_move_valid(row, column, digit, board, topology))
+    {
+      board[row][column] = digit;
+      if (solve_board(board, topology))
+      {
+        return true;
+      }
+      board[row][column] = '.';
+    }
+  }
+  return false;
+}
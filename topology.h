@@ -0,0 +1,188 @@
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+#include <cstddef>
+#include "sudoku.h"
+
+/* DATA-DRIVEN UNIT DEFINITIONS */
+
+// At most 9 rows, 9 columns, 9 subgrids or regions and 2 diagonals
+const int MAX_UNITS = 29;
+
+// A cell on both diagonals belongs to 5 units
+const int MAX_CELL_UNITS = 5;
+
+// Killer cages cover distinct cells, so there can be at most one per cell
+const int MAX_CAGES = 81;
+
+/**
+ * The kinds of unit (group of nine cells that must hold different digits).
+ */
+enum UnitType
+{
+  UNIT_ROW,
+  UNIT_COLUMN,
+  UNIT_SUBGRID,  // a classic 3x3 box
+  UNIT_REGION,   // an irregular (jigsaw) region from a region map
+  UNIT_DIAGONAL, // a main diagonal (X sudoku)
+  UNIT_CAGE      // a killer cage (see killer.h)
+};
+
+/**
+ * The constraint set of a sudoku variant, compiled into lookup tables.
+ *
+ * unit_count - the number of units.
+ * units - the nine cells (row * 9 + column) of each unit.
+ * unit_type, unit_number - the kind of each unit and its number among units of that kind.
+ * cell_unit_count, cell_units - the units each cell belongs to.
+ * peers - for each cell, a 128-bit set (two 64-bit words) of the other cells that share a
+ *         unit or a cage with it, i.e. that must hold a different digit.
+ * cage_count, cage_size, cage_sum, cage_cells - the killer cages, if any: groups of distinct
+ *         digits that must add up to a given sum (added with add_cage).
+ * cell_cage - the cage each cell belongs to, or -1.
+ * placement_keys - for each cell and digit (index d - 1), the XOR of the unit_digit_key of
+ *         the digit in every unit and cage of the cell. XORing the keys of the digits on a
+ *         board gives a Zobrist hash of the digits used in each unit and cage, which the
+ *         search keeps up to date with one XOR per placement.
+ */
+struct Topology
+{
+  int unit_count;
+  unsigned char units[MAX_UNITS][9];
+  unsigned char unit_type[MAX_UNITS];
+  unsigned char unit_number[MAX_UNITS];
+  unsigned char cell_unit_count[81];
+  unsigned char cell_units[81][MAX_CELL_UNITS];
+  unsigned long long peers[81][2];
+  int cage_count;
+  unsigned char cage_size[MAX_CAGES];
+  unsigned char cage_sum[MAX_CAGES];
+  unsigned char cage_cells[MAX_CAGES][9];
+  signed char cell_cage[81];
+  unsigned long long placement_keys[81][9];
+};
+
+
+
+
+/**
+ * Returns the topology of classic sudoku: 9 rows, 9 columns and 9 subgrids.
+ *
+ * @return a reference to a shared, read-only classic topology.
+ */
+const Topology& classic_topology();
+
+
+
+
+/**
+ * Builds a topology from a region map, optionally with the two main diagonals.
+ *
+ * The region map gives every cell a region label; each of the nine labels must be used by
+ * exactly nine cells. A null region map keeps the classic 3x3 subgrids. The topology
+ * starts with no cages.
+ *
+ * @param regions - a 9x9 array of region labels (any nine distinct characters), or NULL.
+ * @param diagonals - whether to add the two main diagonals as units.
+ * @param topology - the topology to build.
+ *
+ * @return SUDOKU_OK - if the topology was built, otherwise SUDOKU_ERROR_INVALID_REGIONS.
+ */
+SudokuStatus build_topology(const char regions[9][9], bool diagonals, Topology& topology);
+
+
+
+
+/**
+ * Parses a region map from a memory buffer, in either board layout accepted by parse_board.
+ *
+ * Any character other than a line ending may label a region, e.g. '1'-'9' or 'a'-'i'.
+ *
+ * @param buffer - the characters to parse (need not be null-terminated).
+ * @param length - the number of characters in the buffer.
+ * @param regions - a 9x9 array that will hold the region labels.
+ *
+ * @return SUDOKU_OK - if the map was parsed, otherwise the code describing the failure.
+ */
+SudokuStatus parse_regions(const char* buffer, size_t length, char regions[9][9]);
+
+
+
+
+/**
+ * Reads a region map file and builds its topology.
+ *
+ * @param filename - a constant character pointer to the region-map path.
+ * @param diagonals - whether to add the two main diagonals as units.
+ * @param topology - the topology to build.
+ *
+ * @return SUDOKU_OK - if the topology was built, otherwise the code describing the failure.
+ */
+SudokuStatus read_topology_file(const char* filename, bool diagonals, Topology& topology);
+
+
+
+
+/**
+ * Returns a 64-bit fingerprint of a topology's units, used to check that saved state
+ * belongs to the same variant.
+ *
+ * @param topology - the topology.
+ *
+ * @return the fingerprint.
+ */
+unsigned long long topology_fingerprint(const Topology& topology);
+
+
+
+
+/**
+ * Returns the random 64-bit key of a digit in a unit, used to build placement_keys.
+ *
+ * The keys are fixed pseudo-random numbers, the same in every run. Cage number c uses the
+ * keys of unit MAX_UNITS + c.
+ *
+ * @param unit - the unit number (0 to MAX_UNITS + MAX_CAGES - 1).
+ * @param digit - the digit index (0-8 for digits '1'-'9').
+ *
+ * @return the key.
+ */
+unsigned long long unit_digit_key(int unit, int digit);
+
+
+
+
+/**
+ * Checks if a digit can be placed in an empty cell under a topology.
+ *
+ * This is the data-driven counterpart of is_move_valid: instead of scanning the row,
+ * column and subgrid it checks the cell's peer set, and for a cell in a killer cage that
+ * the cage can still reach its sum with the digit in it.
+ *
+ * @param row - the row index of the cell (0-8).
+ * @param column - the column index of the cell (0-8).
+ * @param digit - the digit character to be placed.
+ * @param board - a 9x9 character array representing the sudoku board.
+ * @param topology - the units of the variant.
+ *
+ * @return true - if the move is valid, otherwise false.
+ */
+bool is_move_valid(int row, int column, char digit, const char board[9][9], const Topology& topology);
+
+
+
+
+/**
+ * Solves a sudoku variant by recursive backtracking.
+ *
+ * This function is an overloaded version of 'solve_board' that checks moves against the
+ * units of a topology rather than the classic row, column and subgrid.
+ *
+ * @param board - a 9x9 character array representing the current sudoku board.
+ * @param topology - the units of the variant.
+ *
+ * @return true - if the board is successfully solved. Otherwise, it returns false.
+ */
+bool solve_board(char board[9][9], const Topology& topology);
+
+#endif
@@ -0,0 +1,123 @@
+#include <cstdlib>
+#include "transposition.h"
+
+/* TRANSPOSITION TABLE */
+
+/**
+ * Allocates an empty transposition table within a memory budget.
+ *
+ * @param table - the table to create.
+ * @param max_bytes - the most memory the entries may use.
+ *
+ * @return SUDOKU_OK - if the table was created, otherwise the code describing the failure.
+ */
+SudokuStatus transposition_create(TranspositionTable& table, size_t max_bytes)
+{
+  table.entries = NULL;
+  table.capacity = 0;
+  transposition_clear(table);
+
+  unsigned long long capacity = 2;
+  if (max_bytes < capacity * sizeof(TranspositionEntry))
+  {
+    return SUDOKU_ERROR_INVALID_ARGUMENT;
+  }
+  while (capacity * 2 * sizeof(TranspositionEntry) <= max_bytes)
+  {
+    capacity *= 2;
+  }
+
+  // calloc leaves every key 0, which marks the entry empty
+  table.entries = (TranspositionEntry*) calloc(capacity, sizeof(TranspositionEntry));
+  if (!table.entries)
+  {
+    return SUDOKU_ERROR_OUT_OF_MEMORY;
+  }
+  table.capacity = capacity;
+  return SUDOKU_OK;
+}
+
+/**
+ * Empties a transposition table and resets its statistics.
+ *
+ * @param table - the table to clear.
+ */
+void transposition_clear(TranspositionTable& table)
+{
+  for (unsigned long long i = 0; i < table.capacity; i++)
+  {
+    table.entries[i].key = 0;
+  }
+  table.probes = 0;
+  table.hits = 0;
+  table.stores = 0;
+  table.replacements = 0;
+}
+
+/**
+ * Frees the entries of a transposition table.
+ *
+ * @param table - the table to destroy.
+ */
+void transposition_destroy(TranspositionTable& table)
+{
+  free(table.entries);
+  table.entries = NULL;
+  table.capacity = 0;
+}
+
+/**
+ * Looks up the cached result of a search state.
+ *
+ * @param table - the table.
+ * @param key - the hash of the state.
+ * @param count - set to the cached solution count if the state is found.
+ *
+ * @return true - if the state was found, otherwise false.
+ */
+bool transposition_probe(TranspositionTable& table, unsigned long long key, long long& count)
+{
+  table.probes++;
+  TranspositionEntry* bucket = table.entries + (key & (table.capacity - 2));
+  for (int i = 0; i < 2; i++)
+  {
+    if (bucket[i].key == key)
+    {
+      table.hits++;
+      count = bucket[i].count;
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Stores the result of a fully searched subtree.
+ *
+ * @param table - the table.
+ * @param key - the hash of the state the subtree starts from.
+ * @param count - the exact number of solutions in the subtree.
+ * @param work - the number of digits placed to count them.
+ */
+void transposition_store(TranspositionTable& table, unsigned long long key, long long count,
+                         long long work)
+{
+  table.stores++;
+  TranspositionEntry* bucket = table.entries + (key & (table.capacity - 2));
+  const TranspositionEntry entry = { key, count, work };
+
+  // A costlier result takes the first entry and moves its old occupant to the second; the
+  // second entry always takes whatever is left over
+  if (bucket[0].key == 0 || bucket[0].key == key || work >= bucket[0].work)
+  {
+    if (bucket[0].key != 0 && bucket[0].key != key)
+    {
+      table.replacements += bucket[1].key != 0;
+      bucket[1] = bucket[0];
+    }
+    bucket[0] = entry;
+    return;
+  }
+  table.replacements += bucket[1].key != 0 && bucket[1].key != key;
+  bucket[1] = entry;
+}
@@ -0,0 +1,110 @@
+#ifndef TRANSPOSITION_H
+#define TRANSPOSITION_H
+
+#include <cstddef>
+#include "sudoku.h"
+
+/* TRANSPOSITION TABLE */
+
+/**
+ * One cached subtree result.
+ *
+ * key - the full hash of the search state the subtree starts from (0 in an empty entry).
+ * count - the number of solutions in the subtree (0 proves it unsolvable).
+ * work - the number of digits placed to count them, used to decide which entry to keep.
+ */
+struct TranspositionEntry
+{
+  unsigned long long key;
+  long long count;
+  long long work;
+};
+
+/**
+ * A fixed-size cache of subtree solution counts, keyed by the hash of a search state.
+ *
+ * The entries are grouped into buckets of two. The first entry of a bucket keeps the most
+ * expensive result stored there and the second always takes the newest one, so costly
+ * subtrees survive while cheap ones turn over quickly. A table is not thread-safe: each
+ * thread needs its own.
+ *
+ * entries - the entries, capacity of them.
+ * capacity - the number of entries (a power of two, at least 2).
+ * probes, hits - the number of lookups made and how many of them found their state.
+ * stores - the number of results written.
+ * replacements - how many stores overwrote a different state's result.
+ */
+struct TranspositionTable
+{
+  TranspositionEntry* entries;
+  unsigned long long capacity;
+  long long probes;
+  long long hits;
+  long long stores;
+  long long replacements;
+};
+
+
+
+
+/**
+ * Allocates an empty transposition table within a memory budget.
+ *
+ * @param table - the table to create; it must be freed with transposition_destroy.
+ * @param max_bytes - the most memory the entries may use; the table gets the largest power
+ *        of two number of entries that fits.
+ *
+ * @return SUDOKU_OK - if the table was created, otherwise SUDOKU_ERROR_INVALID_ARGUMENT (the
+ *         budget is smaller than one bucket) or SUDOKU_ERROR_OUT_OF_MEMORY.
+ */
+SudokuStatus transposition_create(TranspositionTable& table, size_t max_bytes);
+
+
+
+
+/**
+ * Empties a transposition table and resets its statistics.
+ *
+ * @param table - the table to clear.
+ */
+void transposition_clear(TranspositionTable& table);
+
+
+
+
+/**
+ * Frees the entries of a transposition table.
+ *
+ * @param table - the table to destroy.
+ */
+void transposition_destroy(TranspositionTable& table);
+
+
+
+
+/**
+ * Looks up the cached result of a search state.
+ *
+ * @param table - the table.
+ * @param key - the hash of the state (never 0).
+ * @param count - set to the cached solution count if the state is found.
+ *
+ * @return true - if the state was found, otherwise false.
+ */
+bool transposition_probe(TranspositionTable& table, unsigned long long key, long long& count);
+
+
+
+
+/**
+ * Stores the result of a fully searched subtree.
+ *
+ * @param table - the table.
+ * @param key - the hash of the state the subtree starts from (never 0).
+ * @param count - the exact number of solutions in the subtree.
+ * @param work - the number of digits placed to count them.
+ */
+void transposition_store(TranspositionTable& table, unsigned long long key, long long count,
+                         long long work);
+
+#endif